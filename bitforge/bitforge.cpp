@@ -1,26 +1,356 @@
 #include <bitforge.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
 using namespace std;
 
 namespace BitForge {
     namespace {
-        vector<function<void()>> start_functions;
-        vector<function<void(double)>> update_functions;
+        using Clock = chrono::steady_clock;
+
+        struct Registration {
+            const SystemDescriptor* descriptor;
+            const char* source;
+        };
+
+        struct System {
+            const SystemDescriptor* descriptor;
+            string_view name;
+
+            vector<size_t> dependents;
+            unsigned int dependency_count = 0;
+            atomic<unsigned int> remaining{0};
+
+            Clock::time_point began, ended;
+        };
+
+        // one in-flight phase: its jobs point here instead of capturing anything
+        struct PhaseRun {
+            double delta_time;
+            JobCounter counter;
+        };
+
+        // function-local so registrars in other translation units can run before this one is initialized
+        vector<Registration>& registrations() {
+            static vector<Registration> entries;
+            return entries;
+        }
+
+        // deque keeps System addresses stable and allows the non-movable atomic member
+        deque<System> systems;
+        array<vector<size_t>, PHASE_COUNT> phases;
+        bool graph_built = false;
+        SchedulerStats stats;
+
+        Timing frame_timing;
+        double accumulator = 0.0;
+        // longest frame that still counts in full, anything beyond (debugger breaks, window drags) is dropped
+        const double max_frame_delta = 0.25;
+
+        mutex interpolated_mutex;
+        vector<InterpolatedTransform*>& interpolated() {
+            static vector<InterpolatedTransform*> transforms;
+            return transforms;
+        }
+
+        const SystemInfo& info(const System& system) {
+            return system.descriptor->info;
+        }
+
+        bool touches_everything(const SystemInfo& info) {
+            return info.reads.empty() && info.writes.empty();
+        }
+
+        bool contains(const Names& names, string_view name) {
+            return find(names.begin(), names.end(), name) != names.end();
+        }
+
+        bool intersects(const Names& a, const Names& b) {
+            for (string_view name : a) {
+                if (contains(b, name))
+                    return true;
+            }
+            return false;
+        }
+
+        bool conflicts(const SystemInfo& a, const SystemInfo& b) {
+            if (touches_everything(a) || touches_everything(b))
+                return true;
+            return intersects(a.writes, b.writes) || intersects(a.writes, b.reads) || intersects(a.reads, b.writes);
+        }
+
+        bool must_follow(const System& later, const System& earlier) {
+            return !info(earlier).name.empty() && contains(info(later).after, info(earlier).name);
+        }
+
+        void fail(const string& message) {
+            cout << "ERROR::SCHEDULER:: " << message << endl;
+            throw runtime_error(message);
+        }
+
+        // checks every "after" name against the phases: earlier phases are already satisfied, later
+        // phases can never be
+        void check_after(const System& system) {
+            for (string_view name : info(system).after) {
+                auto other = find_if(systems.begin(), systems.end(), [name](const System& s) { return info(s).name == name; });
+                if (other == systems.end())
+                    cout << "WARNING::SCHEDULER:: " << system.name << " runs after unknown system " << name << endl;
+                else if (info(*other).phase > info(system).phase)
+                    fail(string(system.name) + " runs after " + string(name) + ", which is in a later phase");
+            }
+        }
+
+        // orders one phase by its explicit "after" constraints (lowest sorted index breaks ties), then
+        // chains every conflicting pair along that order so the graph is acyclic by construction
+        void build_phase(vector<size_t>& members) {
+            size_t count = members.size();
+            vector<vector<size_t>> explicit_edges(count);
+            vector<unsigned int> incoming(count, 0);
+            for (size_t i = 0; i < count; i++) {
+                for (size_t j = 0; j < count; j++) {
+                    if (i != j && must_follow(systems[members[j]], systems[members[i]])) {
+                        explicit_edges[i].push_back(j);
+                        incoming[j]++;
+                    }
+                }
+            }
+
+            vector<size_t> order;
+            vector<bool> placed(count, false);
+            while (order.size() < count) {
+                size_t next = count;
+                for (size_t i = 0; i < count; i++) {
+                    if (!placed[i] && incoming[i] == 0) {
+                        next = i;
+                        break;
+                    }
+                }
+                if (next == count) {
+                    string cycle;
+                    for (size_t i = 0; i < count; i++) {
+                        if (!placed[i])
+                            cycle += (cycle.empty() ? "" : ", ") + string(systems[members[i]].name);
+                    }
+                    fail("ordering cycle between " + cycle);
+                }
+                placed[next] = true;
+                order.push_back(members[next]);
+                for (size_t dependent : explicit_edges[next])
+                    incoming[dependent]--;
+            }
+
+            for (size_t a = 0; a < count; a++) {
+                for (size_t b = a + 1; b < count; b++) {
+                    System& first = systems[order[a]];
+                    System& second = systems[order[b]];
+                    if (conflicts(info(first), info(second)) || must_follow(second, first)) {
+                        first.dependents.push_back(order[b]);
+                        second.dependency_count++;
+                    }
+                }
+            }
+            members = order;
+        }
+
+        void build_graph() {
+            vector<Registration> sorted = registrations();
+            auto key = [](const Registration& entry) {
+                string_view name = entry.descriptor->info.name;
+                return make_pair(entry.descriptor->info.phase, name.empty() ? string_view(entry.source) : name);
+            };
+            stable_sort(sorted.begin(), sorted.end(), [&](const Registration& a, const Registration& b) { return key(a) < key(b); });
+
+            systems.clear();
+            for (auto& members : phases)
+                members.clear();
+            for (auto& entry : sorted) {
+                System& system = systems.emplace_back();
+                system.descriptor = entry.descriptor;
+                system.name = entry.descriptor->info.name.empty() ? string_view(entry.source) : entry.descriptor->info.name;
+                phases[static_cast<size_t>(entry.descriptor->info.phase)].push_back(systems.size() - 1);
+            }
+
+            for (auto& system : systems)
+                check_after(system);
+            for (auto& members : phases)
+                build_phase(members);
+            graph_built = true;
+        }
+
+        void run_system(void* data, size_t index, size_t) {
+            PhaseRun& run = *static_cast<PhaseRun*>(data);
+            System& system = systems[index];
+            system.began = Clock::now();
+            system.descriptor->update(run.delta_time);
+            system.ended = Clock::now();
+
+            for (size_t dependent : system.dependents) {
+                if (systems[dependent].remaining.fetch_sub(1, memory_order_acq_rel) == 1)
+                    jobs().submit({run_system, data, dependent, 0}, &run.counter);
+            }
+        }
+
+        void run_phase(Phase phase, double delta_time) {
+            const vector<size_t>& members = phases[static_cast<size_t>(phase)];
+            if (members.empty())
+                return;
+
+            PhaseRun run;
+            run.delta_time = delta_time;
+            run.counter.store(static_cast<unsigned int>(members.size()), memory_order_relaxed);
+            for (size_t index : members)
+                systems[index].remaining.store(systems[index].dependency_count, memory_order_relaxed);
+            for (size_t index : members) {
+                if (systems[index].dependency_count == 0)
+                    jobs().submit({run_system, &run, index, 0}, &run.counter);
+            }
+            jobs().wait(run.counter);
+        }
+
+        double milliseconds(Clock::duration duration) {
+            return chrono::duration<double, milli>(duration).count();
+        }
+
+        // sweeps the start/end points of the tick's updates to measure how long at least two were in flight
+        void collect_stats() {
+            vector<pair<Clock::time_point, int>> events;
+            events.reserve(systems.size() * 2);
+            Clock::time_point first = Clock::time_point::max(), last = Clock::time_point::min();
+            Clock::duration busy = Clock::duration::zero();
+            for (auto& system : systems) {
+                if (info(system).phase == Phase::PRE_RENDER)
+                    continue;
+                events.push_back({system.began, 1});
+                events.push_back({system.ended, -1});
+                first = min(first, system.began);
+                last = max(last, system.ended);
+                busy += system.ended - system.began;
+            }
+            if (events.empty())
+                return;
+            sort(events.begin(), events.end());
+
+            Clock::duration parallel = Clock::duration::zero();
+            int running = 0;
+            for (size_t i = 0; i < events.size(); i++) {
+                if (running >= 2)
+                    parallel += events[i].first - events[i - 1].first;
+                running += events[i].second;
+            }
+
+            stats.frame_ms = milliseconds(last - first);
+            stats.busy_ms = milliseconds(busy);
+            stats.parallel_ms = milliseconds(parallel);
+            stats.threads = jobs().thread_count();
+        }
     }
-    
-    void register_functions(function<void()> start_func, function<void(double)> update_func) {
-        start_functions.push_back(start_func);
-        update_functions.push_back(update_func);
+
+    void register_system(const SystemDescriptor& descriptor, const char* source) {
+        registrations().push_back({&descriptor, source});
+        graph_built = false;
     }
-    
+
     void run_starts() {
-        for (auto& start_func : start_functions) {
-            start_func();
+        if (!graph_built)
+            build_graph();
+        for (auto& system : systems) {
+            system.descriptor->start();
         }
     }
-    
+
     void run_updates(double delta_time) {
-        for (auto& update_func : update_functions) {
-            update_func(delta_time);
+        if (!graph_built)
+            build_graph();
+
+        run_phase(Phase::PRE_UPDATE, delta_time);
+        run_phase(Phase::UPDATE, delta_time);
+        run_phase(Phase::POST_UPDATE, delta_time);
+
+        collect_stats();
+    }
+
+    unsigned int run_frame(double frame_delta) {
+        frame_arena().reset();
+        frame_timing.frame_delta = frame_delta;
+        accumulator += min(frame_delta, max_frame_delta);
+
+        unsigned int ticks = 0;
+        while (accumulator >= frame_timing.fixed_delta && ticks < frame_timing.max_ticks_per_frame) {
+            {
+                lock_guard<mutex> lock(interpolated_mutex);
+                for (auto* transform : interpolated())
+                    transform->snapshot();
+            }
+            world().each_chunk<PreviousTransform, Transform>([](uint32_t count, Entity*, PreviousTransform* previous, Transform* current) {
+                for (uint32_t i = 0; i < count; i++)
+                    previous[i].value = current[i];
+            });
+            run_updates(frame_timing.fixed_delta);
+            accumulator -= frame_timing.fixed_delta;
+            frame_timing.tick_count++;
+            ticks++;
+        }
+        // the guard tripped: the simulation falls behind real time instead of spiralling
+        if (accumulator >= frame_timing.fixed_delta)
+            accumulator = fmod(accumulator, frame_timing.fixed_delta);
+
+        frame_timing.ticks = ticks;
+        frame_timing.alpha = accumulator / frame_timing.fixed_delta;
+
+        if (!graph_built)
+            build_graph();
+        run_phase(Phase::PRE_RENDER, frame_delta);
+        return ticks;
+    }
+
+    void set_tick_rate(double ticks_per_second) {
+        frame_timing.tick_rate = ticks_per_second;
+        frame_timing.fixed_delta = 1.0 / ticks_per_second;
+    }
+
+    void set_max_ticks_per_frame(unsigned int max_ticks) {
+        frame_timing.max_ticks_per_frame = max(max_ticks, 1u);
+    }
+
+    const Timing& timing() {
+        return frame_timing;
+    }
+
+    void track_interpolated(InterpolatedTransform* transform) {
+        lock_guard<mutex> lock(interpolated_mutex);
+        interpolated().push_back(transform);
+    }
+
+    void untrack_interpolated(InterpolatedTransform* transform) {
+        lock_guard<mutex> lock(interpolated_mutex);
+        auto& transforms = interpolated();
+        auto it = find(transforms.begin(), transforms.end(), transform);
+        if (it != transforms.end()) {
+            *it = transforms.back();
+            transforms.pop_back();
         }
     }
-}
\ No newline at end of file
+
+    const SchedulerStats& scheduler_stats() {
+        return stats;
+    }
+
+    JobSystem& jobs() {
+        static JobSystem job_system;
+        return job_system;
+    }
+
+    FrameArena& frame_arena() {
+        static FrameArena arena(jobs().slot_count());
+        return arena;
+    }
+
+    World& world() {
+        static World entity_world;
+        return entity_world;
+    }
+}
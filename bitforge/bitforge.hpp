@@ -1,18 +1,124 @@
 #ifndef BITFORGE_H
 #define BITFORGE_H
 
-#include <functional>
+#include <jobsystem.hpp>
+#include <ecs.hpp>
+#include <framearena.hpp>
+#include <components.hpp>
+#include <transform.hpp>
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <string_view>
 using namespace std;
 
 namespace BitForge {
-    void register_functions(function<void()> start_func, function<void(double)> update_func);
-    
+    // Every tick runs PRE_UPDATE, UPDATE and POST_UPDATE in that order with fixed_delta; PRE_RENDER runs
+    // once per frame after the ticks with the real frame time, right before the render snapshot is taken.
+    enum class Phase : unsigned char {
+        PRE_UPDATE,
+        UPDATE,
+        POST_UPDATE,
+        PRE_RENDER
+    };
+
+    const size_t PHASE_COUNT = 4;
+    const size_t MAX_SYSTEM_NAMES = 8;
+
+    // fixed-capacity list of names so a whole SystemInfo can be a constexpr object
+    struct Names {
+        array<string_view, MAX_SYSTEM_NAMES> items{};
+        size_t count = 0;
+
+        constexpr Names() = default;
+        constexpr Names(initializer_list<string_view> list) {
+            for (string_view name : list) {
+                if (count == MAX_SYSTEM_NAMES)
+                    throw "BitForge::Names: more than MAX_SYSTEM_NAMES names";
+                items[count++] = name;
+            }
+        }
+
+        constexpr const string_view* begin() const { return items.data(); }
+        constexpr const string_view* end() const { return items.data() + count; }
+        constexpr bool empty() const { return count == 0; }
+    };
+
+    // What an update touches. Within a phase, updates whose accesses don't conflict (write/write or
+    // read/write on the same name) run in parallel; "after" names systems that must finish first.
+    // A system that declares no reads or writes is assumed to touch everything and runs alone.
+    // Systems are ordered by phase, then "after", then name, so the order never depends on
+    // which translation unit happened to initialize first.
+    struct SystemInfo {
+        string_view name;
+        Phase phase = Phase::UPDATE;
+        Names reads;
+        Names writes;
+        Names after;
+    };
+
+    // plain function pointers plus metadata, dispatching one is a direct call
+    struct SystemDescriptor {
+        void (*start)();
+        void (*update)(double);
+        SystemInfo info;
+    };
+
+    // timings of the last tick (all update phases)
+    struct SchedulerStats {
+        double frame_ms = 0.0;    // wall time from first update start to last update end
+        double busy_ms = 0.0;     // summed run time of all updates
+        double parallel_ms = 0.0; // wall time during which two or more updates were running
+        unsigned int threads = 1;
+
+        double parallel_fraction() const { return frame_ms > 0.0 ? parallel_ms / frame_ms : 0.0; }
+    };
+
+    // fixed-step clock, updates always see fixed_delta while rendering runs at whatever rate it can
+    struct Timing {
+        double tick_rate = 60.0;                // simulation ticks per second
+        unsigned int max_ticks_per_frame = 8;   // spiral-of-death guard, extra time beyond this is dropped
+        double fixed_delta = 1.0 / 60.0;        // seconds per tick
+        double frame_delta = 0.0;               // real seconds since the previous frame
+        double alpha = 0.0;                     // leftover fraction of a tick, for render interpolation
+        unsigned int ticks = 0;                 // ticks run by the last run_frame
+        unsigned long long tick_count = 0;      // ticks run since startup
+    };
+
+    // the descriptor must have static storage duration; source identifies unnamed systems
+    void register_system(const SystemDescriptor& descriptor, const char* source);
+
+    // validates the system graph (ordering cycles abort startup) and runs every start function
     void run_starts();
-    
+
     void run_updates(double delta_time);
+
+    // accumulates frame_delta, runs one pass over the update phases per whole tick and then PRE_RENDER,
+    // returns the number of ticks run
+    unsigned int run_frame(double frame_delta);
+
+    void set_tick_rate(double ticks_per_second);
+
+    void set_max_ticks_per_frame(unsigned int max_ticks);
+
+    const Timing& timing();
+
+    const SchedulerStats& scheduler_stats();
+
+    JobSystem& jobs();
+
+    // scratch memory for updates, one lane per job thread; everything allocated from it stays valid
+    // until the next run_frame starts, so the render snapshot may still read it
+    FrameArena& frame_arena();
+
+    // entities owned by the simulation thread, updates reach them through queries
+    World& world();
 }
 
-// Macro to easily register functions (single-line to avoid backslashes)
-#define REGISTER(start_func, update_func) namespace { struct FunctionRegistrar { FunctionRegistrar() { BitForge::register_functions(start_func, update_func); } }; static FunctionRegistrar _function_registrar; }
+// Macro to easily register functions, optionally followed by SystemInfo fields (single-line to avoid backslashes);
+// give all of them, in order, -Wextra warns about the ones left out
+// e.g. REGISTER(start, update, .name = "physics", .phase = BitForge::Phase::UPDATE, .reads = {"input"}, .writes = {"transforms"}, .after = {})
+#define REGISTER(start_func, update_func, ...) namespace { constexpr BitForge::SystemDescriptor _system_descriptor{start_func, update_func, {__VA_ARGS__}}; struct FunctionRegistrar { FunctionRegistrar() { BitForge::register_system(_system_descriptor, __FILE__); } }; static FunctionRegistrar _function_registrar; }
 
 #endif
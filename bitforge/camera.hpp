@@ -5,6 +5,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <frustum.hpp>
+
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
     FORWARD,
@@ -65,6 +67,33 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // returns the planes bounding what the camera sees through the given projection
+    BitForge::Frustum GetFrustum(const glm::mat4& projection)
+    {
+        return ExtractFrustum(projection * GetViewMatrix());
+    }
+
+    // extracts the frustum planes from a view-projection matrix (Gribb/Hartmann): a point is inside when
+    // -w <= x, y, z <= w in clip space, and each of those inequalities is a plane in world space
+    static BitForge::Frustum ExtractFrustum(const glm::mat4& viewProjection)
+    {
+        // glm is column major, the rows of the matrix are gathered across columns
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++)
+            rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+
+        BitForge::Frustum frustum;
+        frustum.planes[0] = rows[3] + rows[0];
+        frustum.planes[1] = rows[3] - rows[0];
+        frustum.planes[2] = rows[3] + rows[1];
+        frustum.planes[3] = rows[3] - rows[1];
+        frustum.planes[4] = rows[3] + rows[2];
+        frustum.planes[5] = rows[3] - rows[2];
+        for (glm::vec4& plane : frustum.planes)
+            plane /= glm::length(glm::vec3(plane));
+        return frustum;
+    }
+
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
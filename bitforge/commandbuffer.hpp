@@ -0,0 +1,128 @@
+#ifndef COMMANDBUFFER_H
+#define COMMANDBUFFER_H
+
+#include <glad/glad.h>
+
+#include <gpuculling.hpp>
+#include <shader.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+namespace BitForge {
+    // what a recorded command does when it is replayed
+    enum class CommandType : uint8_t {
+        USE_PROGRAM,
+        SET_INT,
+        DEPTH_STATE,
+        DRAW_CULLED
+    };
+
+    // Command payloads. Objects are referenced by pointer; they have to outlive the replay and must not
+    // be changed by the recording threads, only read.
+    namespace Commands {
+        struct UseProgram {
+            static const CommandType TYPE = CommandType::USE_PROGRAM;
+            const Shader* shader;
+        };
+
+        struct SetInt {
+            static const CommandType TYPE = CommandType::SET_INT;
+            const Shader* shader;
+            UniformHandle uniform;
+            int value;
+        };
+
+        // depth test function and depth writes, e.g. GL_EQUAL without writes after a depth pre-pass
+        struct DepthState {
+            static const CommandType TYPE = CommandType::DEPTH_STATE;
+            GLenum function;
+            GLboolean write;
+        };
+
+        // one batch of GPU-culled indirect commands, see GpuCulling::draw
+        struct DrawCulled {
+            static const CommandType TYPE = CommandType::DRAW_CULLED;
+            const GpuCulling* culling;
+            size_t batch;
+            size_t first;
+            size_t count;
+        };
+    }
+
+    // A list of render commands recorded without touching GL, so any thread can build one, and replayed
+    // later by the thread owning the context. Commands are packed back to back as a one byte type
+    // followed by the payload, copied in and out with memcpy so nothing needs to be aligned. A buffer
+    // keeps its memory across clear(), recording a frame of similar size allocates nothing.
+    //
+    // Recording one buffer is not thread safe; parallel recording gives every job its own buffer and
+    // replays them in order.
+    class CommandBuffer {
+    public:
+        template <typename T>
+        void record(const T& command) {
+            static_assert(std::is_trivially_copyable_v<T>);
+            size_t offset = bytes.size();
+            bytes.resize(offset + 1 + sizeof(T));
+            bytes[offset] = static_cast<std::byte>(T::TYPE);
+            std::memcpy(bytes.data() + offset + 1, &command, sizeof(T));
+            recorded++;
+        }
+
+        void clear() {
+            bytes.clear();
+            recorded = 0;
+        }
+
+        size_t size() const { return recorded; }
+        bool empty() const { return recorded == 0; }
+
+        // issues every command in recording order, on the thread owning the context
+        void execute() const {
+            size_t offset = 0;
+            while (offset < bytes.size()) {
+                CommandType type = static_cast<CommandType>(bytes[offset++]);
+                switch (type) {
+                    case CommandType::USE_PROGRAM: {
+                        Commands::UseProgram command = read<Commands::UseProgram>(offset);
+                        command.shader->use();
+                        break;
+                    }
+                    case CommandType::SET_INT: {
+                        Commands::SetInt command = read<Commands::SetInt>(offset);
+                        command.shader->setInt(command.uniform, command.value);
+                        break;
+                    }
+                    case CommandType::DEPTH_STATE: {
+                        Commands::DepthState command = read<Commands::DepthState>(offset);
+                        glDepthFunc(command.function);
+                        glDepthMask(command.write);
+                        break;
+                    }
+                    case CommandType::DRAW_CULLED: {
+                        Commands::DrawCulled command = read<Commands::DrawCulled>(offset);
+                        command.culling->draw(command.batch, command.first, command.count);
+                        break;
+                    }
+                }
+            }
+        }
+
+    private:
+        std::vector<std::byte> bytes;
+        size_t recorded = 0;
+
+        template <typename T>
+        T read(size_t& offset) const {
+            T command;
+            std::memcpy(&command, bytes.data() + offset, sizeof(T));
+            offset += sizeof(T);
+            return command;
+        }
+    };
+}
+
+#endif
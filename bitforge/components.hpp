@@ -0,0 +1,21 @@
+#ifndef COMPONENTS_H
+#define COMPONENTS_H
+
+#include <transform.hpp>
+
+#include <cstdint>
+
+// Built-in components the engine's own systems understand. Entities with Transform and
+// PreviousTransform are interpolated like InterpolatedTransform: the engine copies Transform
+// into PreviousTransform before every tick.
+struct PreviousTransform {
+    Transform value;
+};
+
+// what to draw for an entity, both ids index resource tables owned by the render thread
+struct Renderable {
+    uint32_t model;
+    uint32_t shader;
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef CPUFEATURES_H
+#define CPUFEATURES_H
+
+// Vector kernels are compiled for AVX2 one function at a time and picked when the program runs, so one
+// binary runs everywhere and only takes the wide path on CPUs that have it. A function marked
+// BITFORGE_TARGET_AVX2 may use AVX2 intrinsics but must only be called when cpu_has_avx2() is true.
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#define BITFORGE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(_MSC_VER) && defined(BITFORGE_X86)
+#include <intrin.h>
+#endif
+
+#if defined(BITFORGE_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BITFORGE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+// MSVC compiles intrinsics without a target switch
+#define BITFORGE_TARGET_AVX2
+#endif
+
+namespace BitForge {
+    inline bool cpu_has_avx2() {
+#if defined(BITFORGE_X86) && (defined(__GNUC__) || defined(__clang__))
+        static const bool has = __builtin_cpu_supports("avx2");
+        return has;
+#elif defined(BITFORGE_X86) && defined(_MSC_VER)
+        static const bool has = [] {
+            int info[4];
+            __cpuid(info, 1);
+            // AVX and OS support for saving the YMM registers
+            bool avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+            __cpuidex(info, 7, 0);
+            return avx && (info[1] & (1 << 5));
+        }();
+        return has;
+#else
+        return false;
+#endif
+    }
+}
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef DYNAMICMESH_H
+#define DYNAMICMESH_H
+
+#include <glad/glad.h>
+
+#include <glresource.hpp>
+#include <glstate.hpp>
+#include <material.hpp>
+#include <mesh.hpp>
+#include <ringbuffer.hpp>
+#include <shader.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+
+// A mesh whose geometry the CPU rewrites every frame (skinning, cloth, procedural shapes). Vertices and
+// indices are streamed into the frame's region of a DynamicRingBuffer instead of living in the shared
+// static buffers, so rewriting them never waits on draws of earlier frames. The vertex array has the
+// same format as the static one, only the buffer bindings move with each update.
+class DynamicMesh {
+public:
+    Material material;
+
+    explicit DynamicMesh(Material material = Material()) : material(material), VAO(BitForge::create_vertex_array())
+    {
+        setupVertexFormat(VAO.get());
+    }
+
+    // copies this frame's geometry into the ring, call once per frame before drawing
+    void update(BitForge::DynamicRingBuffer& ring, std::span<const Vertex> vertices, std::span<const unsigned int> indices)
+    {
+        BitForge::RingAllocation vertex_data = ring.allocate(vertices.size_bytes(), 16);
+        BitForge::RingAllocation index_data = ring.allocate(indices.size_bytes(), sizeof(unsigned int));
+        std::memcpy(vertex_data.data, vertices.data(), vertices.size_bytes());
+        std::memcpy(index_data.data, indices.data(), indices.size_bytes());
+
+        glVertexArrayVertexBuffer(VAO.get(), 0, vertex_data.buffer, vertex_data.offset, sizeof(Vertex));
+        glVertexArrayElementBuffer(VAO.get(), index_data.buffer);
+        firstIndex = static_cast<uintptr_t>(index_data.offset);
+        indexCount = static_cast<GLsizei>(indices.size());
+    }
+
+    // render the geometry of the last update()
+    void draw(Shader& shader)
+    {
+        material.bind(shader);
+        bindVertexArray();
+        glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, reinterpret_cast<const void*>(firstIndex));
+    }
+
+    // count instances in one call, the INSTANCED shader variants read instance baseInstance + gl_InstanceID
+    void drawInstanced(GLsizei count, GLuint baseInstance = 0) const
+    {
+        bindVertexArray();
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, reinterpret_cast<const void*>(firstIndex), count, baseInstance);
+    }
+
+    void bindVertexArray() const
+    {
+        BitForge::gl_state().bindVertexArray(VAO.get());
+    }
+
+private:
+    BitForge::VertexArrayHandle VAO;
+    uintptr_t firstIndex = 0; // byte offset of the indices in the element buffer
+    GLsizei indexCount = 0;
+};
+#endif
@@ -0,0 +1,65 @@
+#ifndef DYNAMICRESOLUTION_H
+#define DYNAMICRESOLUTION_H
+
+#include <algorithm>
+#include <cmath>
+
+namespace BitForge {
+    // Picks the fraction of the window the scene renders at from the GPU time of finished frames, so a
+    // heavy view or a throttling GPU costs resolution instead of frames. GPU time is taken to grow with
+    // the pixels shaded, the square of the scale. The scale moves in steps and waits for a change to
+    // show up in the measurements before the next, so it settles instead of hunting frame to frame.
+    class DynamicResolution {
+    public:
+        static constexpr float STEP = 0.05f;
+        // aim this far below the budget, so frame to frame noise doesn't cross it
+        static constexpr double HEADROOM = 0.9;
+        // weight of the newest frame in the smoothed GPU time
+        static constexpr double SMOOTHING = 0.2;
+        // frames after a change before the next: timer results come back a few frames late
+        static const int SETTLE_FRAMES = 6;
+
+        explicit DynamicResolution(double budget_ms = 16.6, float min_scale = 0.5f, float max_scale = 1.0f)
+            : budget_ms(budget_ms), min_scale(min_scale), max_scale(max_scale), current(max_scale) {}
+
+        // feeds the GPU time of one finished frame
+        void update(double gpu_ms) {
+            smoothed = smoothed > 0.0 ? smoothed + (gpu_ms - smoothed) * SMOOTHING : gpu_ms;
+            if (settle > 0) {
+                settle--;
+                return;
+            }
+
+            double wanted = current * std::sqrt(budget_ms * HEADROOM / std::max(smoothed, 0.01));
+            // over budget goes down right away, headroom has to last a whole step to go back up
+            float next = current;
+            if (wanted < current - STEP * 0.5)
+                next = std::floor(static_cast<float>(wanted) / STEP + 0.001f) * STEP;
+            else if (wanted > current + STEP)
+                next = current + STEP;
+            next = std::clamp(next, min_scale, max_scale);
+            if (next != current) {
+                current = next;
+                settle = SETTLE_FRAMES;
+            }
+        }
+
+        float scale() const { return current; }
+
+        // a window size in pixels at the current scale, at least 1
+        unsigned int scaled(unsigned int size) const {
+            return std::max(1u, static_cast<unsigned int>(size * current + 0.5f));
+        }
+
+        double gpu_ms() const { return smoothed; }
+
+    private:
+        double budget_ms;
+        float min_scale, max_scale;
+        float current;
+        double smoothed = 0.0;
+        int settle = 0;
+    };
+}
+
+#endif
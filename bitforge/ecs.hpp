@@ -0,0 +1,385 @@
+#ifndef ECS_H
+#define ECS_H
+
+#include <algorithm>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace BitForge {
+    // generation is bumped every time an index is recycled, so stale handles stop resolving
+    struct Entity {
+        uint32_t index = UINT32_MAX;
+        uint32_t generation = 0;
+
+        bool operator==(const Entity& other) const = default;
+    };
+
+    const size_t CHUNK_SIZE = 16 * 1024;
+    const size_t MAX_COMPONENTS = 64;
+
+    using ComponentId = uint32_t;
+    using ComponentMask = std::bitset<MAX_COMPONENTS>;
+
+    // how to place, move and destroy a component type inside untyped chunk memory
+    struct ComponentInfo {
+        size_t size;
+        size_t align;
+        void (*move_construct)(void* destination, void* source);
+        void (*destroy)(void* value);
+    };
+
+    namespace detail {
+        inline std::vector<ComponentInfo>& component_infos() {
+            static std::vector<ComponentInfo> infos;
+            return infos;
+        }
+
+        inline std::mutex& component_mutex() {
+            static std::mutex mutex;
+            return mutex;
+        }
+
+        template <typename T>
+        ComponentId register_component() {
+            std::lock_guard<std::mutex> lock(component_mutex());
+            auto& infos = component_infos();
+            if (infos.size() == MAX_COMPONENTS)
+                throw std::length_error("ECS::COMPONENT:: more than MAX_COMPONENTS component types");
+            infos.push_back({
+                sizeof(T), alignof(T),
+                [](void* destination, void* source) { new (destination) T(std::move(*static_cast<T*>(source))); },
+                [](void* value) { static_cast<T*>(value)->~T(); }
+            });
+            return static_cast<ComponentId>(infos.size() - 1);
+        }
+    }
+
+    // ids are handed out on first use and are the same in every translation unit
+    template <typename T>
+    ComponentId component_id() {
+        static const ComponentId id = detail::register_component<std::remove_cvref_t<T>>();
+        return id;
+    }
+
+    inline ComponentInfo component_info(ComponentId id) {
+        std::lock_guard<std::mutex> lock(detail::component_mutex());
+        return detail::component_infos()[id];
+    }
+
+    template <typename... Ts>
+    ComponentMask component_mask() {
+        ComponentMask mask;
+        (mask.set(component_id<Ts>()), ...);
+        return mask;
+    }
+
+    // All entities with exactly the same component set. Storage is a list of 16 KB chunks, each laid
+    // out as structure-of-arrays: [Entity x capacity][A x capacity][B x capacity]... so a query over
+    // A and B streams two dense arrays per chunk.
+    class Archetype {
+    public:
+        struct alignas(64) Chunk {
+            std::byte data[CHUNK_SIZE];
+        };
+
+        ComponentMask mask;
+        std::vector<ComponentId> components; // sorted
+        uint32_t capacity = 0;
+
+        explicit Archetype(const ComponentMask& mask) : mask(mask) {
+            for (ComponentId id = 0; id < MAX_COMPONENTS; id++) {
+                if (mask.test(id)) {
+                    components.push_back(id);
+                    infos.push_back(component_info(id));
+                }
+            }
+            slot_of_component.assign(MAX_COMPONENTS, -1);
+            for (size_t i = 0; i < components.size(); i++)
+                slot_of_component[components[i]] = static_cast<int>(i);
+
+            // largest capacity whose arrays (each aligned for its type) still fit into one chunk
+            size_t row_size = sizeof(Entity);
+            for (auto& info : infos)
+                row_size += info.size;
+            capacity = static_cast<uint32_t>(CHUNK_SIZE / row_size);
+            while (capacity > 0 && !layout(capacity))
+                capacity--;
+            if (capacity == 0)
+                throw std::length_error("ECS::ARCHETYPE:: components do not fit into a single chunk");
+        }
+
+        Archetype(const Archetype&) = delete;
+        Archetype& operator=(const Archetype&) = delete;
+
+        ~Archetype() {
+            for (size_t chunk = 0; chunk < chunks.size(); chunk++) {
+                for (size_t slot = 0; slot < components.size(); slot++) {
+                    for (uint32_t row = 0; row < counts[chunk]; row++)
+                        infos[slot].destroy(element(chunk, slot, row));
+                }
+            }
+        }
+
+        size_t chunk_count() const { return chunks.size(); }
+        uint32_t chunk_size(size_t chunk) const { return counts[chunk]; }
+
+        bool has(ComponentId id) const { return id < MAX_COMPONENTS && mask.test(id); }
+
+        Entity* entities(size_t chunk) {
+            return reinterpret_cast<Entity*>(chunks[chunk]->data);
+        }
+
+        template <typename T>
+        T* array(size_t chunk) {
+            int slot = slot_of_component[component_id<T>()];
+            return reinterpret_cast<T*>(chunks[chunk]->data + offsets[slot]);
+        }
+
+        void* element(size_t chunk, size_t slot, uint32_t row) {
+            return chunks[chunk]->data + offsets[slot] + row * infos[slot].size;
+        }
+
+        void* element_of(ComponentId id, size_t chunk, uint32_t row) {
+            return element(chunk, slot_of_component[id], row);
+        }
+
+        // reserves a row (components are left unconstructed) and returns its chunk/row
+        std::pair<uint32_t, uint32_t> allocate(Entity entity) {
+            if (chunks.empty() || counts.back() == capacity) {
+                chunks.push_back(std::make_unique<Chunk>());
+                counts.push_back(0);
+            }
+            uint32_t chunk = static_cast<uint32_t>(chunks.size() - 1);
+            uint32_t row = counts[chunk]++;
+            entities(chunk)[row] = entity;
+            return {chunk, row};
+        }
+
+        // removes a row whose components are already destroyed or moved out by filling the hole with
+        // the very last row, returns the entity that moved into the hole (or an invalid one)
+        Entity remove(uint32_t chunk, uint32_t row) {
+            uint32_t last_chunk = static_cast<uint32_t>(chunks.size() - 1);
+            uint32_t last_row = counts[last_chunk] - 1;
+            Entity moved;
+            if (chunk != last_chunk || row != last_row) {
+                moved = entities(last_chunk)[last_row];
+                entities(chunk)[row] = moved;
+                for (size_t slot = 0; slot < components.size(); slot++) {
+                    void* source = element(last_chunk, slot, last_row);
+                    infos[slot].move_construct(element(chunk, slot, row), source);
+                    infos[slot].destroy(source);
+                }
+            }
+            if (--counts[last_chunk] == 0) {
+                chunks.pop_back();
+                counts.pop_back();
+            }
+            return moved;
+        }
+
+        void destroy_components(uint32_t chunk, uint32_t row) {
+            for (size_t slot = 0; slot < components.size(); slot++)
+                infos[slot].destroy(element(chunk, slot, row));
+        }
+
+    private:
+        std::vector<ComponentInfo> infos;
+        std::vector<int> slot_of_component;
+        std::vector<size_t> offsets;
+        std::vector<std::unique_ptr<Chunk>> chunks;
+        std::vector<uint32_t> counts;
+
+        bool layout(uint32_t rows) {
+            offsets.clear();
+            size_t offset = sizeof(Entity) * rows;
+            for (auto& info : infos) {
+                offset = (offset + info.align - 1) / info.align * info.align;
+                offsets.push_back(offset);
+                offset += info.size * rows;
+            }
+            return offset <= CHUNK_SIZE;
+        }
+    };
+
+    // Owns every entity and archetype. Structural changes (create, destroy, add, remove) must not
+    // happen while a query over the affected archetypes is running.
+    class World {
+    public:
+        template <typename... Ts>
+        Entity create(Ts&&... components) {
+            Entity entity = allocate_entity();
+            Archetype& archetype = archetype_for(component_mask<Ts...>());
+            auto [chunk, row] = archetype.allocate(entity);
+            (new (archetype.element_of(component_id<Ts>(), chunk, row)) std::remove_cvref_t<Ts>(std::forward<Ts>(components)), ...);
+            records[entity.index] = {&archetype, chunk, row, entity.generation};
+            return entity;
+        }
+
+        void destroy(Entity entity) {
+            if (!alive(entity))
+                return;
+            Record& record = records[entity.index];
+            record.archetype->destroy_components(record.chunk, record.row);
+            relocate(record.archetype->remove(record.chunk, record.row), record.chunk, record.row);
+
+            record.archetype = nullptr;
+            record.generation++;
+            free_indices.push_back(entity.index);
+        }
+
+        bool alive(Entity entity) const {
+            return entity.index < records.size() && records[entity.index].generation == entity.generation && records[entity.index].archetype;
+        }
+
+        template <typename T>
+        bool has(Entity entity) const {
+            return alive(entity) && records[entity.index].archetype->has(component_id<T>());
+        }
+
+        // nullptr when the entity is gone or lacks the component; invalidated by structural changes
+        template <typename T>
+        T* get(Entity entity) {
+            if (!has<T>(entity))
+                return nullptr;
+            Record& record = records[entity.index];
+            return static_cast<T*>(record.archetype->element_of(component_id<T>(), record.chunk, record.row));
+        }
+
+        // the entity has to be alive, there is nowhere to put the component otherwise
+        template <typename T>
+        T& add(Entity entity, T component) {
+            if (!alive(entity))
+                throw std::invalid_argument("ECS::ENTITY:: adding a component to a destroyed entity");
+            if (T* existing = get<T>(entity)) {
+                *existing = std::move(component);
+                return *existing;
+            }
+            Record& record = records[entity.index];
+            ComponentMask mask = record.archetype->mask;
+            mask.set(component_id<T>());
+            move_to(entity, archetype_for(mask));
+            T* value = static_cast<T*>(record.archetype->element_of(component_id<T>(), record.chunk, record.row));
+            new (value) T(std::move(component));
+            return *value;
+        }
+
+        template <typename T>
+        void remove(Entity entity) {
+            if (!has<T>(entity))
+                return;
+            ComponentMask mask = records[entity.index].archetype->mask;
+            mask.reset(component_id<T>());
+            move_to(entity, archetype_for(mask));
+        }
+
+        // calls f(count, entities, Ts* arrays...) once per matching chunk
+        template <typename... Ts, typename F>
+        void each_chunk(F&& f) {
+            ComponentMask query = component_mask<Ts...>();
+            for (auto& archetype : archetypes) {
+                if ((archetype->mask & query) != query)
+                    continue;
+                for (size_t chunk = 0; chunk < archetype->chunk_count(); chunk++)
+                    f(archetype->chunk_size(chunk), archetype->entities(chunk), archetype->template array<Ts>(chunk)...);
+            }
+        }
+
+        // calls f(entity, Ts&...) for every entity that has all of Ts
+        template <typename... Ts, typename F>
+        void each(F&& f) {
+            each_chunk<Ts...>([&f](uint32_t count, Entity* entities, Ts*... arrays) {
+                for (uint32_t i = 0; i < count; i++)
+                    f(entities[i], arrays[i]...);
+            });
+        }
+
+        // like each_chunk, with chunks spread over the job system
+        template <typename... Ts, typename Jobs, typename F>
+        void each_chunk_parallel(Jobs& jobs, F&& f) {
+            ComponentMask query = component_mask<Ts...>();
+            std::vector<std::pair<Archetype*, size_t>> work;
+            for (auto& archetype : archetypes) {
+                if ((archetype->mask & query) != query)
+                    continue;
+                for (size_t chunk = 0; chunk < archetype->chunk_count(); chunk++)
+                    work.push_back({archetype.get(), chunk});
+            }
+            jobs.parallel_for(work.size(), 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    auto [archetype, chunk] = work[i];
+                    f(archetype->chunk_size(chunk), archetype->entities(chunk), archetype->template array<Ts>(chunk)...);
+                }
+            });
+        }
+
+        size_t size() const {
+            return records.size() - free_indices.size();
+        }
+
+    private:
+        struct Record {
+            Archetype* archetype = nullptr;
+            uint32_t chunk = 0;
+            uint32_t row = 0;
+            uint32_t generation = 0;
+        };
+
+        std::vector<std::unique_ptr<Archetype>> archetypes;
+        std::vector<Record> records;
+        std::vector<uint32_t> free_indices;
+
+        Entity allocate_entity() {
+            if (!free_indices.empty()) {
+                uint32_t index = free_indices.back();
+                free_indices.pop_back();
+                return {index, records[index].generation};
+            }
+            records.push_back({});
+            return {static_cast<uint32_t>(records.size() - 1), 0};
+        }
+
+        Archetype& archetype_for(const ComponentMask& mask) {
+            for (auto& archetype : archetypes) {
+                if (archetype->mask == mask)
+                    return *archetype;
+            }
+            archetypes.push_back(std::make_unique<Archetype>(mask));
+            return *archetypes.back();
+        }
+
+        // an entity was swapped into (chunk, row) to fill a hole, point its record at the new place
+        void relocate(Entity moved, uint32_t chunk, uint32_t row) {
+            if (moved.index == UINT32_MAX)
+                return;
+            records[moved.index].chunk = chunk;
+            records[moved.index].row = row;
+        }
+
+        // moves the components shared with the target archetype, drops the others; components only the
+        // target has are left unconstructed for the caller
+        void move_to(Entity entity, Archetype& target) {
+            Record& record = records[entity.index];
+            Archetype& source = *record.archetype;
+            auto [chunk, row] = target.allocate(entity);
+            for (ComponentId id : source.components) {
+                void* value = source.element_of(id, record.chunk, record.row);
+                if (target.has(id))
+                    component_info(id).move_construct(target.element_of(id, chunk, row), value);
+                component_info(id).destroy(value);
+            }
+            relocate(source.remove(record.chunk, record.row), record.chunk, record.row);
+            record = {&target, chunk, row, record.generation};
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef FRAMEARENA_H
+#define FRAMEARENA_H
+
+#include <jobsystem.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace BitForge {
+    // Linear allocator for data that lives at most one frame. Allocating bumps a pointer, freeing is a
+    // no-op and reset() drops everything at once. It is a std::pmr::memory_resource, so pmr containers
+    // can use it directly: std::pmr::vector<int> scratch(&arena);
+    //
+    // Each job system thread bumps its own lane, so updates running in parallel can share one arena
+    // without locking as long as lane_count covers every thread allocating from it.
+    class FrameArena : public std::pmr::memory_resource {
+    public:
+        explicit FrameArena(size_t lane_count = 1, size_t block_size = 256 * 1024) : lanes(std::max<size_t>(lane_count, 1)), block_size(block_size) {}
+
+        FrameArena(const FrameArena&) = delete;
+        FrameArena& operator=(const FrameArena&) = delete;
+
+        // uninitialized storage for count objects of T, valid until the next reset()
+        template <typename T>
+        T* allocate_array(size_t count) {
+            return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+        }
+
+        // rewinds every lane; a lane that spilled into several blocks gets one block big enough for all of
+        // them, so a steady workload stops allocating after its first frame. Nothing may still be allocating.
+        void reset() {
+            for (auto& lane : lanes) {
+                if (lane.blocks.size() > 1) {
+                    size_t total = 0;
+                    for (auto& block : lane.blocks)
+                        total += block.size;
+                    lane.blocks.clear();
+                    lane.blocks.push_back(make_block(total));
+                }
+                lane.block = 0;
+                lane.offset = 0;
+                lane.used = 0;
+            }
+        }
+
+        // bytes handed out since the last reset
+        size_t bytes_used() const {
+            size_t used = 0;
+            for (auto& lane : lanes)
+                used += lane.used;
+            return used;
+        }
+
+        // bytes owned by the arena, including unused space
+        size_t bytes_reserved() const {
+            size_t reserved = 0;
+            for (auto& lane : lanes) {
+                for (auto& block : lane.blocks)
+                    reserved += block.size;
+            }
+            return reserved;
+        }
+
+    protected:
+        void* do_allocate(size_t bytes, size_t alignment) override {
+            Lane& lane = lanes[JobSystem::current_thread() % lanes.size()];
+            while (true) {
+                if (lane.block == lane.blocks.size())
+                    lane.blocks.push_back(make_block(std::max(block_size, bytes + alignment)));
+
+                Block& block = lane.blocks[lane.block];
+                uintptr_t base = reinterpret_cast<uintptr_t>(block.memory.get());
+                uintptr_t aligned = (base + lane.offset + alignment - 1) & ~(uintptr_t(alignment) - 1);
+                size_t end = aligned - base + bytes;
+                if (end <= block.size) {
+                    lane.used += end - lane.offset;
+                    lane.offset = end;
+                    return reinterpret_cast<void*>(aligned);
+                }
+                lane.block++;
+                lane.offset = 0;
+            }
+        }
+
+        void do_deallocate(void*, size_t, size_t) override {}
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+            return this == &other;
+        }
+
+    private:
+        struct Block {
+            std::unique_ptr<std::byte[]> memory;
+            size_t size;
+        };
+
+        // own cache line per lane so threads bumping neighbouring lanes don't false-share
+        struct alignas(64) Lane {
+            std::vector<Block> blocks;
+            size_t block = 0;
+            size_t offset = 0;
+            size_t used = 0;
+        };
+
+        std::vector<Lane> lanes;
+        size_t block_size;
+
+        static Block make_block(size_t size) {
+            return {std::make_unique_for_overwrite<std::byte[]>(size), size};
+        }
+    };
+}
+
+#endif
@@ -3,18 +3,22 @@
 
 #include <glad/glad.h>
 
+#include <glresource.hpp>
+#include <glstate.hpp>
 #include <shader.hpp>
 
-#include <iostream>
 #include <sys/types.h>
 #include <vector>
 #include <string>
 
+// Draws the scene to the window as a textured quad: the opaque color with the transparent surfaces
+// (weighted blended transparency) composited over it, upscaled when the scene rendered to only part of
+// its targets (dynamic resolution). The targets themselves are transient textures of
+// the render graph, see rendergraph.hpp; this only keeps the shader and the quad, and the window size.
+// Owns its GL objects, which go away with it.
 class Framebuffer
 {
 public:
-    unsigned int FBO, RBO, textureColorbuffer;
-
     unsigned int width, height;
     std::vector<float> vertices;
 
@@ -26,97 +30,66 @@ public:
 
         shader.use();
         shader.setInt("screenTexture", 0);
+        shader.setInt("accumTexture", 1);
+        shader.setInt("revealageTexture", 2);
+        sceneScaleHandle = shader.uniform("sceneScale");
 
         init();
     }
 
-    void bind()
-    {
-        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-        glEnable(GL_DEPTH_TEST);
-    }
-
-    void draw()
+    // composites the given targets into the whole window; the scene covers scale of each target's
+    // width and height, from the bottom left corner
+    void draw(GLuint color, GLuint accum, GLuint revealage, glm::vec2 scale = glm::vec2(1.0f))
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glDisable(GL_DEPTH_TEST);
+        BitForge::GLState& state = BitForge::gl_state();
+        state.bindFramebuffer(0);
+        state.disable(GL_DEPTH_TEST);
+        state.disable(GL_BLEND);
+        glViewport(0, 0, width, height);
 
         shader.use();
-        glBindVertexArray(VAO);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
+        shader.setVec2(sceneScaleHandle, scale);
+        state.bindVertexArray(VAO.get());
+        state.bindTexture(0, GL_TEXTURE_2D, color);
+        state.bindTexture(1, GL_TEXTURE_2D, accum);
+        state.bindTexture(2, GL_TEXTURE_2D, revealage);
         glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
     }
 
-    void cleanUp()
-    {
-        glDeleteVertexArrays(1, &VAO);
-        glDeleteBuffers(1, &VBO);
-        glDeleteBuffers(1, &EBO);
-        glDeleteRenderbuffers(1, &RBO);
-        glDeleteFramebuffers(1, &FBO);
-    }
-
+    // the window size, the targets follow it through the render graph
     void resize(unsigned int new_width, unsigned int new_height)
     {
         width = new_width;
         height = new_height;
-
-        // Resize texture
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-
-        // Resize renderbuffer
-        glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
     }
 
 private:
     Shader shader;
+    UniformHandle sceneScaleHandle;
 
-    unsigned int VAO, VBO, EBO;
+    BitForge::VertexArrayHandle VAO;
+    BitForge::BufferHandle VBO, EBO;
 
     std::vector<unsigned int> indices;
 
     void init()
     {
-        glGenFramebuffers(1, &FBO);
-        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
-
-        glGenTextures(1, &textureColorbuffer);
-        glBindTexture(GL_TEXTURE_2D, textureColorbuffer);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, textureColorbuffer, 0);
-
-        glGenRenderbuffers(1, &RBO);
-        glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
-
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!" << std::endl;
-
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
         indices = {
             0, 1, 3,
             1, 2, 3
         };
 
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-        glBindVertexArray(VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), &vertices[0], GL_STATIC_DRAW);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-        glEnableVertexAttribArray(0);
-        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(1);
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)(2 * sizeof(float)));
-        glBindVertexArray(0);
+        VBO = BitForge::create_buffer(vertices.size() * sizeof(float), vertices.data());
+        EBO = BitForge::create_buffer(indices.size() * sizeof(unsigned int), indices.data());
+        VAO = BitForge::create_vertex_array();
+        glVertexArrayVertexBuffer(VAO.get(), 0, VBO.get(), 0, 4 * sizeof(float));
+        glVertexArrayElementBuffer(VAO.get(), EBO.get());
+        glEnableVertexArrayAttrib(VAO.get(), 0);
+        glVertexArrayAttribFormat(VAO.get(), 0, 2, GL_FLOAT, GL_FALSE, 0);
+        glVertexArrayAttribBinding(VAO.get(), 0, 0);
+        glEnableVertexArrayAttrib(VAO.get(), 1);
+        glVertexArrayAttribFormat(VAO.get(), 1, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float));
+        glVertexArrayAttribBinding(VAO.get(), 1, 0);
     }
 };
 
@@ -0,0 +1,88 @@
+#ifndef FRAMEPIPELINE_H
+#define FRAMEPIPELINE_H
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+
+namespace BitForge {
+    // Hands frame snapshots from the simulation thread to the render thread. Each of the N slots is
+    // either free, being written, queued or being drawn, so with N = 2 the simulation fills frame N+1
+    // while frame N is submitted, and with N = 3 it may run two frames ahead. Neither side ever
+    // touches a slot the other one owns, so snapshots need no locking of their own.
+    template <typename T, size_t N = 2>
+    class FramePipeline {
+        static_assert(N >= 2, "a frame pipeline needs at least two slots to overlap");
+
+    public:
+        FramePipeline() {
+            for (size_t i = 0; i < N; i++)
+                free_slots.push_back(i);
+        }
+
+        FramePipeline(const FramePipeline&) = delete;
+        FramePipeline& operator=(const FramePipeline&) = delete;
+
+        // blocks while all slots are queued or drawing; nullptr once the pipeline is closed
+        T* begin_write() {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return closed || !free_slots.empty(); });
+            if (closed)
+                return nullptr;
+            writing = free_slots.front();
+            free_slots.pop_front();
+            return &slots[writing];
+        }
+
+        void end_write() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                queued_slots.push_back(writing);
+            }
+            condition.notify_all();
+        }
+
+        // blocks until a snapshot is queued; nullptr once the pipeline is closed and drained
+        const T* begin_read() {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return closed || !queued_slots.empty(); });
+            if (queued_slots.empty())
+                return nullptr;
+            reading = queued_slots.front();
+            queued_slots.pop_front();
+            return &slots[reading];
+        }
+
+        void end_read() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                free_slots.push_back(reading);
+            }
+            condition.notify_all();
+        }
+
+        // wakes both sides so they can shut down
+        void close() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                closed = true;
+            }
+            condition.notify_all();
+        }
+
+    private:
+        std::array<T, N> slots;
+        std::deque<size_t> free_slots;
+        std::deque<size_t> queued_slots;
+        size_t writing = 0;
+        size_t reading = 0;
+        bool closed = false;
+
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+}
+
+#endif
@@ -0,0 +1,136 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+#include <cpufeatures.hpp>
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace BitForge {
+    // object space extent of a mesh: the axis aligned box around its vertices and a sphere around the
+    // box's center enclosing all of them
+    struct Bounds {
+        glm::vec3 min = glm::vec3(0.0f);
+        glm::vec3 max = glm::vec3(0.0f);
+        glm::vec4 sphere = glm::vec4(0.0f); // center (xyz) and radius (w)
+    };
+
+    // Six planes (left, right, bottom, top, near, far) with normals pointing inwards and unit length, so
+    // dot(plane.xyz, p) + plane.w is the signed distance of p, negative outside.
+    struct Frustum {
+        std::array<glm::vec4, 6> planes;
+    };
+
+    // World space boxes in structure of arrays layout, one array per coordinate, so the culling kernel
+    // loads eight boxes' worth of one coordinate with a single instruction.
+    class BoxList {
+    public:
+        explicit BoxList(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+            : min_x(resource), min_y(resource), min_z(resource), max_x(resource), max_y(resource), max_z(resource) {}
+
+        void reserve(size_t count) {
+            for (std::pmr::vector<float>* array : arrays())
+                array->reserve(count);
+        }
+
+        // adds the world space box around local bounds moved by model (Arvo's method: the new extent
+        // along each axis is the old extent projected through the absolute rotation/scale)
+        void push(const Bounds& bounds, const glm::mat4& model) {
+            glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+            glm::vec3 extent = (bounds.max - bounds.min) * 0.5f;
+            glm::vec3 world_center = glm::vec3(model * glm::vec4(center, 1.0f));
+            glm::vec3 world_extent = glm::abs(glm::vec3(model[0])) * extent.x + glm::abs(glm::vec3(model[1])) * extent.y
+                                   + glm::abs(glm::vec3(model[2])) * extent.z;
+            min_x.push_back(world_center.x - world_extent.x);
+            min_y.push_back(world_center.y - world_extent.y);
+            min_z.push_back(world_center.z - world_extent.z);
+            max_x.push_back(world_center.x + world_extent.x);
+            max_y.push_back(world_center.y + world_extent.y);
+            max_z.push_back(world_center.z + world_extent.z);
+        }
+
+        size_t size() const { return min_x.size(); }
+
+        // coordinate arrays of one axis (0 = x, 1 = y, 2 = z)
+        const float* min(int axis) const { return axis == 0 ? min_x.data() : axis == 1 ? min_y.data() : min_z.data(); }
+        const float* max(int axis) const { return axis == 0 ? max_x.data() : axis == 1 ? max_y.data() : max_z.data(); }
+
+    private:
+        std::pmr::vector<float> min_x, min_y, min_z;
+        std::pmr::vector<float> max_x, max_y, max_z;
+
+        std::array<std::pmr::vector<float>*, 6> arrays() {
+            return {&min_x, &min_y, &min_z, &max_x, &max_y, &max_z};
+        }
+    };
+
+#ifdef BITFORGE_X86
+    // cull_boxes for whole groups of eight boxes, eight per instruction; returns how many boxes it
+    // tested and adds the visible ones to visible_count
+    BITFORGE_TARGET_AVX2 inline size_t cull_boxes_avx2(const Frustum& frustum, const float* const corner[6][3], size_t count,
+                                                       std::span<uint8_t> visible, size_t& visible_count) {
+        const __m256 zero = _mm256_setzero_ps();
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < 6; p++) {
+                const glm::vec4& plane = frustum.planes[p];
+                __m256 distance = _mm256_set1_ps(plane.w);
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.x), _mm256_loadu_ps(corner[p][0] + i)));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.y), _mm256_loadu_ps(corner[p][1] + i)));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(plane.z), _mm256_loadu_ps(corner[p][2] + i)));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, zero, _CMP_GE_OQ));
+            }
+            unsigned int mask = static_cast<unsigned int>(_mm256_movemask_ps(inside));
+            for (int lane = 0; lane < 8; lane++)
+                visible[i + lane] = (mask >> lane) & 1;
+            visible_count += static_cast<size_t>(std::popcount(mask));
+        }
+        return i;
+    }
+#endif
+
+    // Tests every box against the frustum, writing 1 (visible) or 0 to visible[i] and returning the
+    // number of visible boxes. A box is culled when its corner furthest along a plane's normal is still
+    // behind that plane; boxes crossing a corner of the frustum outside every single plane are kept,
+    // which is conservative. On CPUs with AVX2 eight boxes are tested per instruction, the remainder (and
+    // everything on other CPUs) goes through the scalar loop.
+    inline size_t cull_boxes(const Frustum& frustum, const BoxList& boxes, std::span<uint8_t> visible) {
+        const size_t count = boxes.size();
+        size_t visible_count = 0;
+        size_t i = 0;
+
+        // per plane, the coordinate arrays holding the furthest corner: max where the normal is positive
+        const float* corner[6][3];
+        for (int p = 0; p < 6; p++) {
+            const glm::vec4& plane = frustum.planes[p];
+            for (int axis = 0; axis < 3; axis++)
+                corner[p][axis] = plane[axis] >= 0.0f ? boxes.max(axis) : boxes.min(axis);
+        }
+
+#ifdef BITFORGE_X86
+        if (cpu_has_avx2())
+            i = cull_boxes_avx2(frustum, corner, count, visible, visible_count);
+#endif
+
+        for (; i < count; i++) {
+            bool inside = true;
+            for (int p = 0; p < 6 && inside; p++) {
+                const glm::vec4& plane = frustum.planes[p];
+                inside = plane.x * corner[p][0][i] + plane.y * corner[p][1][i] + plane.z * corner[p][2][i] + plane.w >= 0.0f;
+            }
+            visible[i] = inside;
+            visible_count += inside;
+        }
+        return visible_count;
+    }
+}
+
+#endif
@@ -0,0 +1,181 @@
+#ifndef GEOMETRYBUFFER_H
+#define GEOMETRYBUFFER_H
+
+#include <glad/glad.h>
+
+#include <glresource.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace BitForge {
+    // layout glMultiDrawElementsIndirect reads from the draw indirect buffer
+    struct DrawElementsIndirectCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    // Hands out ranges of [0, capacity) elements. Free ranges are kept sorted by offset and merged with
+    // both neighbours when a range is freed, so freeing everything always leaves one range and
+    // fragmentation only lasts as long as the allocations causing it. First fit.
+    class OffsetAllocator {
+    public:
+        static const size_t FAILED = SIZE_MAX;
+
+        explicit OffsetAllocator(size_t capacity) : total(capacity) {
+            if (capacity > 0)
+                free_list.push_back({0, capacity});
+        }
+
+        // offset of a new range of size elements, FAILED when no free range is big enough
+        size_t allocate(size_t size) {
+            for (size_t i = 0; i < free_list.size(); i++) {
+                Range& range = free_list[i];
+                if (range.size < size)
+                    continue;
+                size_t offset = range.offset;
+                range.offset += size;
+                range.size -= size;
+                if (range.size == 0)
+                    free_list.erase(free_list.begin() + i);
+                return offset;
+            }
+            return FAILED;
+        }
+
+        void free(size_t offset, size_t size) {
+            if (size == 0)
+                return;
+            auto next = std::lower_bound(free_list.begin(), free_list.end(), offset, [](const Range& range, size_t value) { return range.offset < value; });
+            bool merges_previous = next != free_list.begin() && (next - 1)->offset + (next - 1)->size == offset;
+            bool merges_next = next != free_list.end() && offset + size == next->offset;
+
+            if (merges_previous && merges_next) {
+                (next - 1)->size += size + next->size;
+                free_list.erase(next);
+            } else if (merges_previous) {
+                (next - 1)->size += size;
+            } else if (merges_next) {
+                next->offset = offset;
+                next->size += size;
+            } else {
+                free_list.insert(next, {offset, size});
+            }
+        }
+
+        // extends the managed space, the new tail merges with a free range ending at the old capacity
+        void grow(size_t capacity) {
+            if (capacity <= total)
+                return;
+            size_t old = total;
+            total = capacity;
+            free(old, capacity - old);
+        }
+
+        size_t capacity() const { return total; }
+
+        // number of separate free ranges, 1 means no fragmentation
+        size_t free_ranges() const { return free_list.size(); }
+
+    private:
+        struct Range {
+            size_t offset;
+            size_t size;
+        };
+
+        std::vector<Range> free_list;
+        size_t total;
+    };
+
+    // where a mesh lives inside a GeometryBuffer
+    struct GeometryRange {
+        GLint baseVertex = 0;
+        GLuint firstIndex = 0;
+        GLuint indexCount = 0;
+        GLuint vertexCount = 0;
+    };
+
+    // Shared vertex and index buffers that static meshes are suballocated from, behind one vertex array,
+    // so drawing different meshes needs no VAO change and a whole run of them fits in one multi-draw.
+    // Indices stay relative to their mesh; draws add baseVertex. Running out of space doubles the buffer
+    // and copies the old contents on the GPU, offsets stay valid.
+    class GeometryBuffer {
+    public:
+        // setup_format declares the vertex attributes on the given vertex array, reading binding point 0
+        GeometryBuffer(GLsizei vertex_stride, void (*setup_format)(GLuint), size_t vertex_capacity = 256 * 1024, size_t index_capacity = 1024 * 1024)
+            : vao(create_vertex_array()), vertex_buffer(create_storage(vertex_capacity * vertex_stride)),
+              index_buffer(create_storage(index_capacity * sizeof(GLuint))), stride(vertex_stride),
+              vertex_allocator(vertex_capacity), index_allocator(index_capacity) {
+            setup_format(vao.get());
+            attach();
+        }
+
+        // copies a mesh in, growing the buffers when they are full
+        GeometryRange add(const void* vertices, size_t vertex_count, const GLuint* indices, size_t index_count) {
+            size_t vertex_offset = allocate(vertex_allocator, vertex_buffer, stride, vertex_count);
+            size_t index_offset = allocate(index_allocator, index_buffer, sizeof(GLuint), index_count);
+
+            glNamedBufferSubData(vertex_buffer.get(), vertex_offset * stride, vertex_count * stride, vertices);
+            glNamedBufferSubData(index_buffer.get(), index_offset * sizeof(GLuint), index_count * sizeof(GLuint), indices);
+
+            GeometryRange range;
+            range.baseVertex = static_cast<GLint>(vertex_offset);
+            range.firstIndex = static_cast<GLuint>(index_offset);
+            range.indexCount = static_cast<GLuint>(index_count);
+            range.vertexCount = static_cast<GLuint>(vertex_count);
+            return range;
+        }
+
+        // returns a mesh's space; whatever still references it must not be drawn anymore
+        void remove(const GeometryRange& range) {
+            vertex_allocator.free(range.baseVertex, range.vertexCount);
+            index_allocator.free(range.firstIndex, range.indexCount);
+        }
+
+        GLuint vertexArray() const { return vao.get(); }
+
+        size_t free_ranges() const { return vertex_allocator.free_ranges() + index_allocator.free_ranges(); }
+
+    private:
+        VertexArrayHandle vao;
+        BufferHandle vertex_buffer, index_buffer;
+        GLsizei stride;
+        OffsetAllocator vertex_allocator;
+        OffsetAllocator index_allocator;
+
+        // fixed size, written with glNamedBufferSubData as meshes are added
+        static BufferHandle create_storage(size_t bytes) {
+            return create_buffer(bytes, nullptr, GL_DYNAMIC_STORAGE_BIT);
+        }
+
+        // points the vertex array at the current buffers; the attribute format is independent of them
+        void attach() {
+            glVertexArrayVertexBuffer(vao.get(), 0, vertex_buffer.get(), 0, stride);
+            glVertexArrayElementBuffer(vao.get(), index_buffer.get());
+        }
+
+        size_t allocate(OffsetAllocator& allocator, BufferHandle& buffer, size_t element_size, size_t count) {
+            size_t offset = allocator.allocate(count);
+            while (offset == OffsetAllocator::FAILED) {
+                size_t old_capacity = allocator.capacity();
+                size_t capacity = std::max(old_capacity * 2, old_capacity + count);
+                BufferHandle grown = create_storage(capacity * element_size);
+                glCopyNamedBufferSubData(buffer.get(), grown.get(), 0, 0, old_capacity * element_size);
+                buffer = std::move(grown);
+                attach();
+
+                allocator.grow(capacity);
+                offset = allocator.allocate(count);
+            }
+            return offset;
+        }
+    };
+}
+
+#endif
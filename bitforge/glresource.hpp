@@ -0,0 +1,131 @@
+#ifndef GLRESOURCE_H
+#define GLRESOURCE_H
+
+#include <glad/glad.h>
+
+#include <glstate.hpp>
+
+#include <cstddef>
+#include <utility>
+
+// Owning handles for GL objects, created through direct state access (GL 4.5): objects are created and
+// filled by name, so setting one up never disturbs what is bound. A handle deletes its object when it
+// goes away and can only be moved, so a GL name always has exactly one owner. Like all GL calls, handles
+// must be created and destroyed on the thread owning the context, while the context is still current.
+namespace BitForge {
+    template <typename Traits>
+    class GLHandle {
+    public:
+        GLHandle() = default;
+        explicit GLHandle(GLuint name) : name(name) {}
+
+        ~GLHandle() {
+            reset();
+        }
+
+        GLHandle(GLHandle&& other) noexcept : name(std::exchange(other.name, 0)) {}
+
+        GLHandle& operator=(GLHandle&& other) noexcept {
+            if (this != &other) {
+                reset();
+                name = std::exchange(other.name, 0);
+            }
+            return *this;
+        }
+
+        GLHandle(const GLHandle&) = delete;
+        GLHandle& operator=(const GLHandle&) = delete;
+
+        GLuint get() const { return name; }
+        explicit operator bool() const { return name != 0; }
+
+        // deletes the object, then takes ownership of replacement
+        void reset(GLuint replacement = 0) {
+            if (name != 0)
+                Traits::destroy(name);
+            name = replacement;
+        }
+
+    private:
+        GLuint name = 0;
+    };
+
+    // textures, vertex arrays and framebuffers are shadowed by the state cache, which has to forget them
+    struct BufferTraits {
+        static void destroy(GLuint name) { glDeleteBuffers(1, &name); }
+    };
+
+    struct TextureTraits {
+        static void destroy(GLuint name) { gl_state().deleteTexture(name); }
+    };
+
+    struct VertexArrayTraits {
+        static void destroy(GLuint name) { gl_state().deleteVertexArray(name); }
+    };
+
+    struct FramebufferTraits {
+        static void destroy(GLuint name) { gl_state().deleteFramebuffer(name); }
+    };
+
+    struct QueryTraits {
+        static void destroy(GLuint name) { glDeleteQueries(1, &name); }
+    };
+
+    using BufferHandle = GLHandle<BufferTraits>;
+    using TextureHandle = GLHandle<TextureTraits>;
+    using VertexArrayHandle = GLHandle<VertexArrayTraits>;
+    using FramebufferHandle = GLHandle<FramebufferTraits>;
+    using QueryHandle = GLHandle<QueryTraits>;
+
+    // immutable storage of bytes, flags as for glBufferStorage (0 for data only the GPU touches after creation)
+    inline BufferHandle create_buffer(size_t bytes, const void* data = nullptr, GLbitfield flags = 0) {
+        GLuint name;
+        glCreateBuffers(1, &name);
+        glNamedBufferStorage(name, static_cast<GLsizeiptr>(bytes), data, flags);
+        return BufferHandle(name);
+    }
+
+    // a buffer without storage yet, for glNamedBufferData (e.g. orphaning streams)
+    inline BufferHandle create_mutable_buffer() {
+        GLuint name;
+        glCreateBuffers(1, &name);
+        return BufferHandle(name);
+    }
+
+    // immutable storage for levels mip levels; sampler parameters are left to the caller
+    inline TextureHandle create_texture_2d(GLenum internal_format, GLsizei width, GLsizei height, GLsizei levels = 1) {
+        GLuint name;
+        glCreateTextures(GL_TEXTURE_2D, 1, &name);
+        glTextureStorage2D(name, levels, internal_format, width, height);
+        return TextureHandle(name);
+    }
+
+    // layers slices of immutable storage, all of the same size and format
+    inline TextureHandle create_texture_2d_array(GLenum internal_format, GLsizei width, GLsizei height, GLsizei layers, GLsizei levels = 1) {
+        GLuint name;
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &name);
+        glTextureStorage3D(name, levels, internal_format, width, height, layers);
+        return TextureHandle(name);
+    }
+
+    inline VertexArrayHandle create_vertex_array() {
+        GLuint name;
+        glCreateVertexArrays(1, &name);
+        return VertexArrayHandle(name);
+    }
+
+    inline FramebufferHandle create_framebuffer() {
+        GLuint name;
+        glCreateFramebuffers(1, &name);
+        return FramebufferHandle(name);
+    }
+
+    // a query object of target (GL_TIME_ELAPSED, GL_SAMPLES_PASSED, ...)
+    inline QueryHandle create_query(GLenum target) {
+        GLuint name;
+        glCreateQueries(target, 1, &name);
+        return QueryHandle(name);
+    }
+}
+
+#endif
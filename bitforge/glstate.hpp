@@ -0,0 +1,180 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/glad.h>
+
+#include <array>
+#include <cstddef>
+
+namespace BitForge {
+    // Shadow copy of the GL state the engine changes most: program, vertex array, framebuffer, active
+    // texture unit, 2D texture per unit and a few capabilities. Every call compares against the shadow
+    // first and only reaches the driver when the state really changes. All code touching this state has
+    // to go through the cache (or call invalidate() afterwards), otherwise the shadow goes stale.
+    //
+    // GL state belongs to the context, so the cache must only be used on the thread owning it.
+    class GLState {
+    public:
+        static const unsigned int TEXTURE_UNITS = 32;
+
+        void useProgram(GLuint program) {
+            if (!track(program_bound, program))
+                return;
+            glUseProgram(program);
+        }
+
+        void bindVertexArray(GLuint vertex_array) {
+            if (!track(vertex_array_bound, vertex_array))
+                return;
+            glBindVertexArray(vertex_array);
+        }
+
+        // binds both the draw and the read framebuffer, like glBindFramebuffer(GL_FRAMEBUFFER, ...)
+        void bindFramebuffer(GLuint framebuffer) {
+            if (!track(framebuffer_bound, framebuffer))
+                return;
+            glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        }
+
+        // unit is the index, not GL_TEXTURE0 + index
+        void activeTexture(GLuint unit) {
+            if (!track(active_unit, unit))
+                return;
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+
+        // other targets go straight to the driver, they are rare enough not to be worth a shadow
+        void bindTexture(GLuint unit, GLenum target, GLuint texture) {
+            if (target != GL_TEXTURE_2D || unit >= TEXTURE_UNITS) {
+                activeTexture(unit);
+                glBindTexture(target, texture);
+                issued++;
+                return;
+            }
+            if (textures_bound[unit] == texture) {
+                elided++;
+                return;
+            }
+            activeTexture(unit);
+            track(textures_bound[unit], texture);
+            glBindTexture(GL_TEXTURE_2D, texture);
+        }
+
+        void enable(GLenum capability) {
+            set(capability, true);
+        }
+
+        void disable(GLenum capability) {
+            set(capability, false);
+        }
+
+        void set(GLenum capability, bool enabled) {
+            int slot = capability_slot(capability);
+            GLuint value = enabled ? 1 : 0;
+            if (slot >= 0 && !track(capabilities[slot], value))
+                return;
+            if (slot < 0)
+                issued++;
+            if (enabled)
+                glEnable(capability);
+            else
+                glDisable(capability);
+        }
+
+        // deleting an object unbinds it; the shadow has to follow or a recycled name would be skipped
+        void deleteProgram(GLuint program) {
+            glDeleteProgram(program);
+            forget(program_bound, program);
+        }
+
+        void deleteVertexArray(GLuint vertex_array) {
+            glDeleteVertexArrays(1, &vertex_array);
+            forget(vertex_array_bound, vertex_array);
+        }
+
+        void deleteFramebuffer(GLuint framebuffer) {
+            glDeleteFramebuffers(1, &framebuffer);
+            forget(framebuffer_bound, framebuffer);
+        }
+
+        void deleteTexture(GLuint texture) {
+            glDeleteTextures(1, &texture);
+            for (GLuint& bound : textures_bound)
+                forget(bound, texture);
+        }
+
+        // forget everything, e.g. after code that calls GL directly; the next call of each kind goes through
+        void invalidate() {
+            program_bound = vertex_array_bound = framebuffer_bound = active_unit = UNKNOWN;
+            textures_bound.fill(UNKNOWN);
+            capabilities.fill(UNKNOWN);
+        }
+
+        // driver calls made and skipped since the last reset_counters()
+        unsigned int calls_issued() const { return issued; }
+        unsigned int calls_elided() const { return elided; }
+
+        void reset_counters() {
+            issued = 0;
+            elided = 0;
+        }
+
+    private:
+        // nothing is known about a fresh context, so the first call of each kind always goes through
+        static const GLuint UNKNOWN = ~GLuint(0);
+
+        GLuint program_bound = UNKNOWN;
+        GLuint vertex_array_bound = UNKNOWN;
+        GLuint framebuffer_bound = UNKNOWN;
+        GLuint active_unit = UNKNOWN;
+        std::array<GLuint, TEXTURE_UNITS> textures_bound = filled();
+        std::array<GLuint, 6> capabilities = filled<6>();
+
+        unsigned int issued = 0;
+        unsigned int elided = 0;
+
+        template <size_t N = TEXTURE_UNITS>
+        static std::array<GLuint, N> filled() {
+            std::array<GLuint, N> values;
+            values.fill(UNKNOWN);
+            return values;
+        }
+
+        // updates the shadow, false (and counted as elided) when it already holds value
+        bool track(GLuint& shadow, GLuint value) {
+            if (shadow == value) {
+                elided++;
+                return false;
+            }
+            shadow = value;
+            issued++;
+            return true;
+        }
+
+        // unknown rather than 0: a program deleted while in use stays bound until replaced
+        static void forget(GLuint& shadow, GLuint name) {
+            if (shadow == name)
+                shadow = UNKNOWN;
+        }
+
+        static int capability_slot(GLenum capability) {
+            switch (capability) {
+                case GL_DEPTH_TEST: return 0;
+                case GL_BLEND: return 1;
+                case GL_CULL_FACE: return 2;
+                case GL_MULTISAMPLE: return 3;
+                case GL_FRAMEBUFFER_SRGB: return 4;
+                case GL_STENCIL_TEST: return 5;
+                default: return -1;
+            }
+        }
+    };
+
+    // the cache of the render thread's context
+    inline GLState& gl_state() {
+        static GLState state;
+        return state;
+    }
+}
+
+#endif
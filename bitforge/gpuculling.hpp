@@ -0,0 +1,181 @@
+#ifndef GPUCULLING_H
+#define GPUCULLING_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <geometrybuffer.hpp>
+#include <hizbuffer.hpp>
+#include <instancebatch.hpp>
+#include <ringbuffer.hpp>
+#include <shader.hpp>
+#include <streambuffer.hpp>
+#include <uniformblocks.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace BitForge {
+    // An indirect command as the culling shader sees it: the draw itself with instanceCount left at 0 for
+    // culling to fill, the batch (multi-draw) it belongs to and where that batch's commands begin, the
+    // bit recording the mesh in its objects' visibility history and the mesh's object space bounding
+    // sphere. 48 bytes.
+    struct CullCommand {
+        DrawElementsIndirectCommand command;
+        GLuint batch;
+        GLuint batchFirst;
+        GLuint historyBit; // 0 to 31, meshes of one object sharing a bit only make culling more conservative, or'ed with CULL_LATE
+        glm::vec4 sphere;
+    };
+
+    // historyBit flag: the command draws nothing in phase 1 and everything visible in phase 2, after all
+    // opaque depth is down (e.g. transparent meshes, which neither occlude nor may be drawn twice)
+    const GLuint CULL_LATE = 1u << 5;
+
+    static_assert(sizeof(CullCommand) == 48 && offsetof(CullCommand, sphere) == 32);
+
+    // what culling needs to know about one instance besides its transform
+    struct InstanceCull {
+        GLuint command; // index of the command drawing it
+        GLuint object;  // stable across frames (e.g. the entity index), keys the visibility history
+    };
+
+    // Frustum and occlusion culling of every instance on the GPU, feeding the indirect draws without a
+    // round trip to the CPU. Occlusion runs in two phases against a Hi-Z pyramid of this frame's depth:
+    // 1. draw the instances inside the frustum that were visible last frame, they are likely occluders
+    // 2. rebuild the Hi-Z from that depth, test every instance against it, draw the visible ones phase 1
+    //    skipped and remember all visible ones for the next frame's phase 1
+    // Every phase runs cull.comp twice:
+    // - one invocation per instance appends the instances to draw to the command's slice of the Visible
+    //   buffer and bumps its instanceCount, so the CULLED shader variants read
+    //   instances[visible[gl_BaseInstance + gl_InstanceID]]
+    // - one invocation per command moves commands that kept any instance, and their per-draw data, to
+    //   the front of their batch and counts them; glMultiDrawElementsIndirectCount then only walks
+    //   the survivors
+    // What the CPU writes (commands, instances, per-draw data) lives in the frame's ring region, the
+    // buffers culling writes itself are orphaned per phase.
+    // The instance buffer has to be bound (InstanceBatch::bind) and the View block uploaded before cull().
+    class GpuCulling {
+    public:
+        GpuCulling()
+            : cull_shader(Shader::compute("cull")), compact_shader(Shader::compute("cull", "#define COMPACT\n")),
+              visible(GL_SHADER_STORAGE_BUFFER), compacted(GL_SHADER_STORAGE_BUFFER), draw_outputs(GL_SHADER_STORAGE_BUFFER),
+              batch_counts(GL_SHADER_STORAGE_BUFFER), histories{StreamBuffer<GLuint>(GL_SHADER_STORAGE_BUFFER), StreamBuffer<GLuint>(GL_SHADER_STORAGE_BUFFER)} {
+            instance_count_uniform = cull_shader.uniform("instanceCount");
+            phase_uniform = cull_shader.uniform("phase");
+            command_count_uniform = compact_shader.uniform("commandCount");
+            cull_shader.use();
+            cull_shader.setInt("hiZ", HIZ_TEXTURE_UNIT);
+        }
+
+        GpuCulling(const GpuCulling&) = delete;
+        GpuCulling& operator=(const GpuCulling&) = delete;
+
+        // starts a frame: commands in submission order, grouped by batch; instances in instance buffer
+        // order; draw_data the per-draw data of each command; objects one past the largest object index.
+        // commands must stay valid until the last cull() of the frame.
+        void begin(DynamicRingBuffer& ring, std::span<const CullCommand> commands, std::span<const InstanceCull> instances, std::span<const DrawData> draw_data,
+                   size_t batch_count, size_t objects) {
+            frame_commands = commands;
+            this->batch_count = batch_count;
+            instance_count = instances.size();
+            instance_culls = ring.allocate_storage<InstanceCull>(instances.size());
+            std::copy(instances.begin(), instances.end(), instance_culls.as<InstanceCull>(instances.size()).begin());
+            draw_inputs = ring.allocate_storage<DrawData>(draw_data.size());
+            std::copy(draw_data.begin(), draw_data.end(), draw_inputs.as<DrawData>(draw_data.size()).begin());
+
+            // last frame's result becomes the input, a grown history starts over as all hidden
+            next = 1 - next;
+            StreamBuffer<GLuint>& history = histories[1 - next];
+            if (objects > history.size()) {
+                size_t size = std::max(objects, history.size() * 2);
+                clear(history, size);
+                clear(histories[next], size);
+            } else {
+                clear(histories[next], history.size());
+            }
+        }
+
+        // culls for phase 1 or 2 and leaves the buffers the following draw() calls read bound; phase 2
+        // reads the Hi-Z pyramid, which has to be built from the depth phase 1 left
+        void cull(DynamicRingBuffer& ring, int phase, const HiZBuffer& hiz) {
+            // every phase counts from zero in a fresh copy, the previous phase's draws still read theirs
+            commands = ring.allocate_storage<CullCommand>(frame_commands.size());
+            std::copy(frame_commands.begin(), frame_commands.end(), commands.as<CullCommand>(frame_commands.size()).begin());
+            commands.bindRange(GL_SHADER_STORAGE_BUFFER, CULL_COMMAND_BINDING);
+            instance_culls.bindRange(GL_SHADER_STORAGE_BUFFER, INSTANCE_CULL_BINDING);
+            visible.resize(instance_count);
+            visible.bindBase(VISIBLE_BINDING);
+            histories[1 - next].bindBase(HISTORY_BINDING);
+            histories[next].bindBase(NEXT_HISTORY_BINDING);
+            hiz.bind();
+
+            cull_shader.use();
+            cull_shader.setInt(instance_count_uniform, static_cast<int>(instance_count));
+            cull_shader.setInt(phase_uniform, phase);
+            glDispatchCompute(groups(instance_count), 1, 1);
+
+            compacted.resize(frame_commands.size());
+            compacted.bindBase(COMPACTED_BINDING);
+            draw_outputs.resize(frame_commands.size());
+            draw_outputs.bindBase(DRAW_BINDING);
+            draw_inputs.bindRange(GL_SHADER_STORAGE_BUFFER, DRAW_INPUT_BINDING);
+            clear(batch_counts, batch_count);
+            batch_counts.bindBase(BATCH_COUNT_BINDING);
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+            compact_shader.use();
+            compact_shader.setInt(command_count_uniform, static_cast<int>(frame_commands.size()));
+            glDispatchCompute(groups(frame_commands.size()), 1, 1);
+
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, compacted.id());
+            glBindBuffer(GL_PARAMETER_BUFFER, batch_counts.id());
+        }
+
+        // draws what survived of one batch, whose commands start at first; the caller has bound the
+        // program and material and set the program's drawOffset to first
+        void draw(size_t batch, size_t first, size_t count) const {
+            glMultiDrawElementsIndirectCount(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>(first * sizeof(DrawElementsIndirectCommand)),
+                                             static_cast<GLintptr>(batch * sizeof(GLuint)), static_cast<GLsizei>(count), 0);
+        }
+
+    private:
+        static const GLuint GROUP_SIZE = 64; // local_size_x of cull.comp
+
+        Shader cull_shader;
+        Shader compact_shader;
+        UniformHandle instance_count_uniform;
+        UniformHandle phase_uniform;
+        UniformHandle command_count_uniform;
+
+        RingAllocation commands;
+        RingAllocation instance_culls;
+        RingAllocation draw_inputs;
+        StreamBuffer<GLuint> visible;
+        StreamBuffer<DrawElementsIndirectCommand> compacted;
+        StreamBuffer<DrawData> draw_outputs;
+        StreamBuffer<GLuint> batch_counts;
+        // visibility history of the last and of this frame, alternating
+        StreamBuffer<GLuint> histories[2];
+        unsigned int next = 0;
+
+        std::span<const CullCommand> frame_commands;
+        size_t batch_count = 0;
+        size_t instance_count = 0;
+
+        // fresh storage for count zeros
+        static void clear(StreamBuffer<GLuint>& buffer, size_t count) {
+            buffer.resize(count);
+            glClearNamedBufferData(buffer.id(), GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, NULL);
+        }
+
+        static GLuint groups(size_t count) {
+            return static_cast<GLuint>((count + GROUP_SIZE - 1) / GROUP_SIZE);
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,91 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include <glad/glad.h>
+
+#include <glresource.hpp>
+#include <glstate.hpp>
+#include <shader.hpp>
+
+#include <algorithm>
+#include <bit>
+
+namespace BitForge {
+    // texture unit the pyramid is bound to while culling reads it, clear of the material units
+    const GLuint HIZ_TEXTURE_UNIT = 8;
+
+    // Hierarchical depth: a mip chain of the depth buffer where every texel keeps the farthest depth of
+    // the texels below it. Whether a screen rectangle is hidden takes at most four reads, at the level
+    // where the rectangle spans no more than two texels per axis. Built by hiz.comp, level by level.
+    class HiZBuffer {
+    public:
+        HiZBuffer(unsigned int width, unsigned int height)
+            : copy_shader(Shader::compute("hiz", "#define COPY\n")), reduce_shader(Shader::compute("hiz")) {
+            copy_shader.use();
+            copy_shader.setInt("depth", HIZ_TEXTURE_UNIT);
+            allocate(width, height);
+        }
+
+        HiZBuffer(const HiZBuffer&) = delete;
+        HiZBuffer& operator=(const HiZBuffer&) = delete;
+
+        void resize(unsigned int new_width, unsigned int new_height) {
+            if (new_width == width && new_height == height)
+                return;
+            allocate(new_width, new_height);
+        }
+
+        // rebuilds every level from a depth texture of the same size; the depth must not be sampled
+        // through a mipmapped filter, only level 0 is read. Readers of the pyramid have to wait with
+        // glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT), which the render graph issues for them.
+        void build(GLuint depth_texture) {
+            GLState& state = gl_state();
+            state.bindTexture(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, depth_texture);
+            copy_shader.use();
+            glBindImageTexture(1, texture.get(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            glDispatchCompute(groups(width), groups(height), 1);
+
+            reduce_shader.use();
+            for (GLint level = 1; level < levels; level++) {
+                glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+                glBindImageTexture(0, texture.get(), level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+                glBindImageTexture(1, texture.get(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+                glDispatchCompute(groups(std::max(width >> level, 1u)), groups(std::max(height >> level, 1u)), 1);
+            }
+        }
+
+        // binds the pyramid to HIZ_TEXTURE_UNIT
+        void bind() const {
+            gl_state().bindTexture(HIZ_TEXTURE_UNIT, GL_TEXTURE_2D, texture.get());
+        }
+
+        GLuint id() const { return texture.get(); }
+
+    private:
+        static const unsigned int GROUP_SIZE = 8; // local_size_x and local_size_y of hiz.comp
+
+        Shader copy_shader;
+        Shader reduce_shader;
+        TextureHandle texture;
+        unsigned int width, height;
+        GLint levels;
+
+        void allocate(unsigned int new_width, unsigned int new_height) {
+            width = std::max(new_width, 1u);
+            height = std::max(new_height, 1u);
+            levels = static_cast<GLint>(std::bit_width(std::max(width, height)));
+
+            texture = create_texture_2d(GL_R32F, width, height, levels);
+            glTextureParameteri(texture.get(), GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            glTextureParameteri(texture.get(), GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTextureParameteri(texture.get(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(texture.get(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        }
+
+        static GLuint groups(unsigned int size) {
+            return (size + GROUP_SIZE - 1) / GROUP_SIZE;
+        }
+    };
+}
+
+#endif
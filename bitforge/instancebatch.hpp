@@ -0,0 +1,69 @@
+#ifndef INSTANCEBATCH_H
+#define INSTANCEBATCH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ringbuffer.hpp>
+#include <transform.hpp>
+#include <uniformblocks.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+
+namespace BitForge {
+    // Per-instance data as the INSTANCED shader variants read it from the std430 Instances buffer. The
+    // normal matrix is a GLSL mat3, whose std430 columns are padded to vec4, hence mat3x4.
+    struct InstanceData {
+        glm::mat4 model;
+        glm::mat3x4 normal;
+
+        static InstanceData from(const Transform& transform) {
+            return {transform.matrix(), glm::mat3x4(transform.normal_matrix())};
+        }
+    };
+
+    static_assert(sizeof(InstanceData) == 112 && alignof(InstanceData) <= 16);
+
+    // Per-draw data of an indirect multi-draw, read by the INDIRECT shader variant at drawOffset + gl_DrawID.
+    // Everything a draw used to set as material uniforms that is not a texture goes here.
+    struct DrawData {
+        GLuint material;
+        float shininess;
+        GLuint padding[2];
+    };
+
+    static_assert(sizeof(DrawData) == 16);
+
+    // Per-instance data of one frame, placed in the frame's ring region and bound as the Instances storage
+    // buffer. Draws index it with gl_BaseInstance + gl_InstanceID, so one upload can feed many instanced draws.
+    class InstanceBatch {
+    public:
+        // room for count instances, written in place by the caller
+        std::span<InstanceData> allocate(DynamicRingBuffer& ring, size_t count) {
+            allocation = ring.allocate_storage<InstanceData>(count);
+            this->count = count;
+            return allocation.as<InstanceData>(count);
+        }
+
+        void upload(DynamicRingBuffer& ring, std::span<const InstanceData> instances) {
+            std::span<InstanceData> data = allocate(ring, instances.size());
+            std::copy(instances.begin(), instances.end(), data.begin());
+        }
+
+        void bind() const {
+            allocation.bindRange(GL_SHADER_STORAGE_BUFFER, INSTANCE_BINDING);
+        }
+
+        GLsizei size() const {
+            return static_cast<GLsizei>(count);
+        }
+
+    private:
+        RingAllocation allocation;
+        size_t count = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,213 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace BitForge {
+    // counts the unfinished jobs of a batch, wait on it to join the batch
+    using JobCounter = std::atomic<unsigned int>;
+
+    // A job is a plain function pointer with its arguments, copying one never allocates. data must
+    // stay alive until the job's counter reaches zero.
+    struct Job {
+        void (*function)(void* data, size_t begin, size_t end) = nullptr;
+        void* data = nullptr;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+
+    // Work-stealing job system. Every thread owns a deque: it pushes and pops its own jobs at the back
+    // (newest first, still hot in cache) while idle threads steal from the front of the others.
+    // The thread that created the system is thread 0 and only runs jobs while it waits on a counter.
+    // Other threads outside the pool that submit jobs (e.g. a render thread) claim a queue of their own
+    // with attach_producer() first; every queue has exactly one thread pushing to it.
+    class JobSystem {
+    public:
+        explicit JobSystem(unsigned int thread_count = std::thread::hardware_concurrency(), unsigned int producer_count = 1)
+            : threads(std::max(thread_count, 1u)), owner(std::this_thread::get_id()) {
+            for (unsigned int i = 0; i < threads + producer_count; i++)
+                queues.push_back(std::make_unique<Queue>());
+            next_producer = threads;
+
+            thread_index() = 0;
+            for (unsigned int i = 1; i < threads; i++)
+                workers.emplace_back([this, i] { worker_loop(i); });
+        }
+
+        ~JobSystem() {
+            {
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                stopping = true;
+            }
+            sleep_condition.notify_all();
+            for (auto& worker : workers)
+                worker.join();
+        }
+
+        JobSystem(const JobSystem&) = delete;
+        JobSystem& operator=(const JobSystem&) = delete;
+
+        // gives the calling thread, which is neither the owner nor a worker, its own queue to submit to;
+        // once per thread, at most producer_count threads
+        void attach_producer() {
+            unsigned int index = next_producer.fetch_add(1, std::memory_order_relaxed);
+            if (index >= queues.size())
+                throw std::length_error("JOBSYSTEM:: more submitting threads than producer queues");
+            thread_index() = index;
+        }
+
+        // queues a job on the calling thread's deque; the counter (if any) must already include it
+        void submit(const Job& job, JobCounter* counter = nullptr) {
+            if (thread_index() == 0 && std::this_thread::get_id() != owner)
+                throw std::logic_error("JOBSYSTEM:: submitting from a thread without a queue, call attach_producer() first");
+            Queue& queue = *queues[thread_index()];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.jobs.push_back({job, counter});
+            }
+            {
+                // taking the sleep lock orders this wakeup after a worker's last empty check
+                std::lock_guard<std::mutex> lock(sleep_mutex);
+                queued.fetch_add(1, std::memory_order_release);
+            }
+            sleep_condition.notify_one();
+        }
+
+        // runs queued jobs on the calling thread until the counter drops to zero
+        void wait(const JobCounter& counter) {
+            while (counter.load(std::memory_order_acquire) > 0) {
+                if (!run_one(thread_index()))
+                    std::this_thread::yield();
+            }
+        }
+
+        // splits [0, count) into chunks of at most grain elements and runs body(begin, end) on each
+        template <typename F>
+        void parallel_for(size_t count, size_t grain, F&& body) {
+            if (count == 0)
+                return;
+            grain = std::max<size_t>(grain, 1);
+            size_t chunks = (count + grain - 1) / grain;
+            if (chunks == 1 || threads == 1) {
+                body(0, count);
+                return;
+            }
+
+            using Body = std::remove_reference_t<F>;
+            JobCounter counter(static_cast<unsigned int>(chunks));
+            for (size_t begin = 0; begin < count; begin += grain) {
+                size_t end = std::min(begin + grain, count);
+                Job job;
+                job.function = [](void* data, size_t first, size_t last) { (*static_cast<Body*>(data))(first, last); };
+                job.data = const_cast<void*>(static_cast<const void*>(std::addressof(body)));
+                job.begin = begin;
+                job.end = end;
+                submit(job, &counter);
+            }
+            wait(counter);
+        }
+
+        // threads running jobs, the owner included
+        unsigned int thread_count() const {
+            return threads;
+        }
+
+        // how many values current_thread() can take, the size of per thread tables
+        unsigned int slot_count() const {
+            return static_cast<unsigned int>(queues.size());
+        }
+
+        // index of the calling thread: 0 for the owning thread and for threads outside the pool, then the
+        // workers, then attached producers
+        static unsigned int current_thread() {
+            return thread_index();
+        }
+
+    private:
+        struct Entry {
+            Job job;
+            JobCounter* counter;
+        };
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Entry> jobs;
+        };
+
+        unsigned int threads;
+        std::thread::id owner;
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<unsigned int> next_producer;
+
+        std::mutex sleep_mutex;
+        std::condition_variable sleep_condition;
+        std::atomic<unsigned int> queued{0};
+        bool stopping = false;
+
+        static unsigned int& thread_index() {
+            static thread_local unsigned int index = 0;
+            return index;
+        }
+
+        bool pop(unsigned int index, Entry& entry) {
+            Queue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+                return false;
+            entry = queue.jobs.back();
+            queue.jobs.pop_back();
+            return true;
+        }
+
+        bool steal(unsigned int index, Entry& entry) {
+            Queue& queue = *queues[index];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            if (queue.jobs.empty())
+                return false;
+            entry = queue.jobs.front();
+            queue.jobs.pop_front();
+            return true;
+        }
+
+        bool run_one(unsigned int self) {
+            Entry entry;
+            bool found = pop(self % queues.size(), entry);
+            for (size_t i = 1; !found && i < queues.size(); i++)
+                found = steal(static_cast<unsigned int>((self + i) % queues.size()), entry);
+            if (!found)
+                return false;
+
+            queued.fetch_sub(1, std::memory_order_relaxed);
+            entry.job.function(entry.job.data, entry.job.begin, entry.job.end);
+            if (entry.counter)
+                entry.counter->fetch_sub(1, std::memory_order_acq_rel);
+            return true;
+        }
+
+        void worker_loop(unsigned int index) {
+            thread_index() = index;
+            while (true) {
+                if (run_one(index))
+                    continue;
+
+                std::unique_lock<std::mutex> lock(sleep_mutex);
+                sleep_condition.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) > 0; });
+                if (stopping)
+                    return;
+            }
+        }
+    };
+}
+
+#endif
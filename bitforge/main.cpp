@@ -6,9 +6,33 @@
 #include <model.hpp>
 #include <framebuffer.hpp>
 #include <bitforge.hpp>
-
+#include <commandbuffer.hpp>
+#include <dynamicresolution.hpp>
+#include <framepipeline.hpp>
+#include <frustum.hpp>
+#include <geometrybuffer.hpp>
+#include <glstate.hpp>
+#include <gpuculling.hpp>
+#include <hizbuffer.hpp>
+#include <instancebatch.hpp>
+#include <materiallibrary.hpp>
+#include <occlusionbuffer.hpp>
+#include <queryring.hpp>
+#include <renderqueue.hpp>
+#include <rendergraph.hpp>
+#include <renderstats.hpp>
+#include <ringbuffer.hpp>
+#include <uniformblocks.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <ostream>
 #include <iostream>
+#include <iterator>
+#include <memory_resource>
+#include <thread>
+#include <vector>
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
@@ -16,6 +40,55 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void process_input(GLFWwindow *window);
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods);
 
+// render resources, Renderable ids index the tables the render thread loads
+enum ModelId : uint32_t { MODEL_BACKPACK, MODEL_SPHERE, MODEL_CUBE };
+// objects whose material cuts out or is transparent are drawn with SHADER_OBJECT_ALPHA_TESTED or
+// SHADER_OBJECT_TRANSPARENT, the render thread picks them
+enum ShaderId : uint32_t { SHADER_OBJECT, SHADER_LIGHT, SHADER_OBJECT_ALPHA_TESTED, SHADER_OBJECT_TRANSPARENT };
+
+struct DrawItem
+{
+    BitForge::InstanceData instance;
+    uint32_t model_id;
+    uint32_t shader_id;
+    uint32_t object; // entity index, identifies the item across frames
+};
+
+// everything the render thread needs to draw one frame, written by the simulation thread;
+// variable-sized data lives in the slot's own arena, which is rewound when the slot is reused
+struct FrameState
+{
+    BitForge::FrameArena arena;
+
+    unsigned int width, height;
+    // uploaded as is into the shared uniform blocks
+    BitForge::ViewBlock view;
+    BitForge::LightBlock lights;
+    BitForge::Frustum frustum;
+    bool depth_prepass;
+    std::pmr::vector<DrawItem> draws{&arena};
+};
+
+// draws recorded on the job system, one command buffer and bound state per chunk of batches, replayed in
+// chunk order by the render thread; the buffers keep their memory from frame to frame
+struct CommandList
+{
+    std::vector<BitForge::CommandBuffer> buffers;
+    std::vector<BitForge::DrawState> states;
+    size_t chunks = 0;
+
+    explicit CommandList(size_t count) : buffers(count), states(count) {}
+
+    void execute() const
+    {
+        for (size_t chunk = 0; chunk < chunks; chunk++)
+            buffers[chunk].execute();
+    }
+};
+
+void render_loop(GLFWwindow* window, BitForge::FramePipeline<FrameState>* frames);
+void render_frames(GLFWwindow* window, BitForge::FramePipeline<FrameState>* frames);
+
 // settings
 unsigned int scr_width = 600;
 unsigned int scr_height = 600;
@@ -27,9 +100,17 @@ float lastY = scr_height / 2.0f;
 bool first_mouse = true;
 bool mouse_locked = true;
 
+// rendering, P toggles
+bool depth_prepass = true;
+bool prepass_key_down = false;
+
 // timing
-float delta_time = 0.0f;
-float last_frame = 0.0f;
+double delta_time = 0.0;
+double last_frame = 0.0;
+
+// scene
+BitForge::Entity light_entity;
+BitForge::LightBlock scene_lights;
 
 int main()
 {
@@ -37,7 +118,7 @@ int main()
     // ------------------------------
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
     glfwWindowHint(GLFW_SAMPLES, 4);
 
@@ -75,24 +156,172 @@ int main()
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     stbi_set_flip_vertically_on_load(true);
 
+    // hand the context over to the render thread, this thread keeps input and simulation
+    // ----------------------------------------------------------------------------------
+    glfwMakeContextCurrent(NULL);
+    BitForge::FramePipeline<FrameState> frames;
+    // the job system belongs to this thread, so it has to exist before the render thread attaches to it
+    BitForge::jobs();
+    std::thread render_thread(render_loop, window, &frames);
+
+    // spawn the scene
+    // ---------------
+    Transform light_transform = {glm::vec3(0.7f, 0.2f, 2.0f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.2f)};
+    light_entity = BitForge::world().create(light_transform, PreviousTransform{light_transform}, Renderable{MODEL_SPHERE, SHADER_LIGHT});
+    BitForge::world().create(Transform(), PreviousTransform(), Renderable{MODEL_BACKPACK, SHADER_OBJECT});
+
+    // lighting parameters that never change, positions are filled in every frame
+    // directional light
+    scene_lights.dirLight.direction = glm::vec3(-0.2f, -1.0f, -0.3f);
+    scene_lights.dirLight.ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+    scene_lights.dirLight.diffuse = glm::vec3(0.4f, 0.4f, 0.4f);
+    scene_lights.dirLight.specular = glm::vec3(0.5f, 0.5f, 0.5f);
+
+    // point light
+    scene_lights.pointLights[0].ambient = glm::vec3(0.05f, 0.05f, 0.05f);
+    scene_lights.pointLights[0].diffuse = glm::vec3(0.8f, 0.8f, 0.8f);
+    scene_lights.pointLights[0].specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    scene_lights.pointLights[0].constant = 1.0f;
+    scene_lights.pointLights[0].linear = 0.09f;
+    scene_lights.pointLights[0].quadratic = 0.032f;
+
+    // flashlight
+    scene_lights.spotLight.ambient = glm::vec3(0.0f, 0.0f, 0.0f);
+    scene_lights.spotLight.diffuse = glm::vec3(1.0f, 1.0f, 1.0f);
+    scene_lights.spotLight.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    scene_lights.spotLight.constant = 1.0f;
+    scene_lights.spotLight.linear = 0.09f;
+    scene_lights.spotLight.quadratic = 0.032f;
+    scene_lights.spotLight.cutOff = glm::cos(glm::radians(0.0f));
+    scene_lights.spotLight.outerCutOff = glm::cos(glm::radians(0.0f));
+
+    // simulation runs at a fixed rate independent of the render rate
+    BitForge::set_tick_rate(60.0);
+    BitForge::set_max_ticks_per_frame(8);
+    BitForge::run_starts();
+
+    // simulation loop
+    // ---------------
+    while (!glfwWindowShouldClose(window))
+    {
+        // per-frame time logic
+        // --------------------
+        double currentFrame = glfwGetTime();
+        delta_time = currentFrame - last_frame;
+        last_frame = currentFrame;
+
+        // input
+        // -----
+        glfwPollEvents();
+        process_input(window);
+
+        BitForge::run_frame(delta_time);
+        float alpha = static_cast<float>(BitForge::timing().alpha);
+
+        // snapshot everything the render thread needs, blocks while it is still behind on older frames
+        // ---------------------------------------------------------------------------------------------
+        FrameState* frame = frames.begin_write();
+        if (!frame)
+            break;
+
+        frame->width = scr_width;
+        frame->height = scr_height;
+        frame->view = {};
+        frame->view.projection = glm::perspective(glm::radians(camera.Zoom), (float)scr_width / (float)scr_height, 0.1f, 100.0f);
+        frame->view.view = camera.GetViewMatrix();
+        frame->view.position = camera.Position;
+        frame->view.front = camera.Front;
+        frame->frustum = camera.GetFrustum(frame->view.projection);
+        frame->depth_prepass = depth_prepass;
+
+        BitForge::World& world = BitForge::world();
+        frame->lights = scene_lights;
+        frame->lights.pointLights[0].position = Transform::interpolate(world.get<PreviousTransform>(light_entity)->value, *world.get<Transform>(light_entity), alpha).position;
+        frame->lights.spotLight.position = camera.Position;
+        frame->lights.spotLight.direction = camera.Front;
+
+        // the render thread is done with whatever this slot held before
+        frame->draws = std::pmr::vector<DrawItem>(&frame->arena);
+        frame->arena.reset();
+
+        // walk the packed transform/renderable arrays chunk by chunk, chunks run on the job system and
+        // each claims its own range of the draw list
+        frame->draws.resize(world.size());
+        std::atomic<size_t> draw_count{0};
+        world.each_chunk_parallel<Transform, PreviousTransform, Renderable>(BitForge::jobs(), [&](uint32_t count, BitForge::Entity* entities, Transform* current, PreviousTransform* previous, Renderable* renderable)
+        {
+            DrawItem* out = frame->draws.data() + draw_count.fetch_add(count, std::memory_order_relaxed);
+            for (uint32_t i = 0; i < count; i++)
+                out[i] = {BitForge::InstanceData::from(Transform::interpolate(previous[i].value, current[i], alpha)), renderable[i].model, renderable[i].shader, entities[i].index};
+        });
+        frame->draws.resize(draw_count.load(std::memory_order_relaxed));
+
+        frames.end_write();
+    }
+
+    frames.close();
+    render_thread.join();
+
+    // glfw: terminate, clearing all previously allocated GLFW resources.
+    // ------------------------------------------------------------------
+    glfwTerminate();
+    return 0;
+}
+
+// owns the GL context while rendering; GPU resources are released before the context is let go
+void render_loop(GLFWwindow* window, BitForge::FramePipeline<FrameState>* frames)
+{
+    glfwMakeContextCurrent(window);
+    // draws are recorded on the job system from this thread, through a queue of its own
+    BitForge::jobs().attach_producer();
+    render_frames(window, frames);
+    glfwMakeContextCurrent(NULL);
+}
+
+// loads GPU resources, then draws every snapshot the simulation publishes
+void render_frames(GLFWwindow* window, BitForge::FramePipeline<FrameState>* frames)
+{
     // configure global opengl state
     // -----------------------------
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glEnable(GL_CULL_FACE);
-    glEnable(GL_MULTISAMPLE);
-    glEnable(GL_FRAMEBUFFER_SRGB);
+    // capabilities and bindings go through the state cache so it can skip redundant changes
+    BitForge::GLState& gl = BitForge::gl_state();
+    // blending is only on while the transparent pass draws
+    gl.enable(GL_DEPTH_TEST);
+    gl.enable(GL_CULL_FACE);
+    gl.enable(GL_MULTISAMPLE);
+    gl.enable(GL_FRAMEBUFFER_SRGB);
 
     glDepthFunc(GL_LEQUAL);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     glCullFace(GL_BACK);
 
-    // build and compile shaders
-    // -------------------------
-    Shader object_shader("default");
-    Shader light_shader("light");
-
-    // main framebuffer
+    // build and compile shaders, in ShaderId order
+    // ---------------------------------------------
+    // everything is drawn by indirect multi-draws: objects use the INDIRECT variant, which reads its material
+    // parameters per draw, lights only need the per-instance transforms of the INSTANCED variant; both read
+    // the instances that survived GPU culling (CULLED). Only objects with cut out textures discard, only
+    // transparent ones write the weighted blended transparency targets.
+    Shader shaders[] = { Shader("default", "#define INDIRECT\n#define CULLED\n"), Shader("light", "#define INSTANCED\n#define CULLED\n"),
+                         Shader("default", "#define INDIRECT\n#define CULLED\n#define ALPHA_TEST\n"),
+                         Shader("default", "#define INDIRECT\n#define CULLED\n#define TRANSPARENT\n") };
+    UniformHandle draw_offset_uniforms[std::size(shaders)];
+    for (size_t i = 0; i < std::size(shaders); i++)
+        draw_offset_uniforms[i] = shaders[i].uniform("drawOffset");
+    // lays down the depth of opaque geometry so the main pass shades every pixel once
+    Shader depth_shader("depth", "#define CULLED\n");
+
+    // camera and light data is shared by every program through uniform blocks, model matrices come from the
+    // instance buffer; indirect commands and per-draw data are produced by culling. Everything the CPU writes
+    // per frame goes through the persistently mapped ring, one region per frame in flight.
+    BitForge::DynamicRingBuffer ring;
+    BitForge::InstanceBatch instances;
+    BitForge::GpuCulling culling;
+    BitForge::UniformBlock<BitForge::ViewBlock> view_uniforms(BitForge::VIEW_BINDING);
+    BitForge::UniformBlock<BitForge::LightBlock> light_uniforms(BitForge::LIGHT_BINDING);
+
+    // passes and their render targets, declared anew every frame
+    BitForge::RenderGraph graph;
+
+    // composites the targets into the window
     Framebuffer framebuffer(scr_width, scr_height, "framebuffer", {
         -1.0f,  1.0f, 0.0f, 1.0f,
         -1.0f, -1.0f, 0.0f, 0.0f,
@@ -100,120 +329,385 @@ int main()
         1.0f,  1.0f, 1.0f, 1.0f
     });
 
-    glfwSetWindowUserPointer(window, &framebuffer);
+    // occlusion culling tests against a depth pyramid of what is already drawn
+    BitForge::HiZBuffer hiz(scr_width, scr_height);
 
-    // load models
-    // -----------
-    Model backpack_model("backpack");
-    Model light_model("sphere");
-    Model cube_model("cube");
+    // the scene's resolution follows the GPU time of the frame, holding 60 frames per second
+    BitForge::DynamicResolution resolution(1000.0 / 60.0);
+    BitForge::QueryRing frame_timer(GL_TIME_ELAPSED, 1);
 
-    BitForge::run_starts();
+    // load models, in ModelId order
+    // -----------------------------
+    Model models[] = { Model("backpack"), Model("sphere"), Model("cube") };
+    // every texture the models brought becomes a texture array layer
+    BitForge::materials().build();
+    // whose occluders hide other things, the light sphere is too small to be worth rasterizing
+    const bool model_occludes[] = { true, false, true };
+
+    // software occlusion culling, drops hidden meshes before they become draw packets
+    BitForge::OcclusionBuffer occlusion;
+
+    // temporary allocations made while submitting a frame, rewound once it is submitted
+    BitForge::FrameArena render_arena;
+
+    // draws of the depth pre-pass, of the opaque and alpha tested passes and of the transparent pass,
+    // recorded on the job system
+    const size_t MIN_BATCHES_PER_CHUNK = 64;
+    CommandList prepass_commands(std::max(BitForge::jobs().thread_count(), 1u));
+    CommandList main_commands(std::max(BitForge::jobs().thread_count(), 1u));
+    CommandList transparent_commands(std::max(BitForge::jobs().thread_count(), 1u));
+
+    // fragments shaded by the main passes of both phases and the transparent pass
+    BitForge::QueryRing overdraw_queries(GL_FRAGMENT_SHADER_INVOCATIONS, 3);
+
+    // setup lookups and binds don't count towards the first frame
+    Shader::lookups.store(0);
+    gl.reset_counters();
 
     // DEBUG: draw in wireframe
     // glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
     // render loop
     // -----------
-    while (!glfwWindowShouldClose(window))
+    while (const FrameState* frame = frames->begin_read())
     {
-        // per-frame time logic
-        // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        delta_time = currentFrame - last_frame;
-        last_frame = currentFrame;
-
-        framebuffer.width = scr_width;
-        framebuffer.height = scr_height;
-
-        // input
-        // -----
-        process_input(window);
-
-        BitForge::run_updates(delta_time);
-
-        framebuffer.bind();
+        // window resizes arrive through the snapshot, GL calls are only legal on this thread
+        if (frame->width != framebuffer.width || frame->height != framebuffer.height)
+            framebuffer.resize(frame->width, frame->height);
+        // the scene renders to the bottom left part of its targets, which stay the size of the window so
+        // a new scale reallocates nothing but the Hi-Z pyramid
+        unsigned int scene_width = resolution.scaled(frame->width);
+        unsigned int scene_height = resolution.scaled(frame->height);
+        hiz.resize(scene_width, scene_height);
+
+        // waits for the GPU only if it is still reading the region of three frames ago
+        ring.begin_frame();
 
         // render
         // ------
-        glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // view/projection transformations
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)scr_width / (float)scr_height, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
-
-        // render "sun"
-        light_shader.use();
-        light_shader.setMat4("projection", projection);
-        light_shader.setMat4("view", view);
-
-        glm::mat4 model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.7f, 0.2f, 2.0f));
-        model = glm::scale(model, glm::vec3(0.2f)); // Make it a smaller cube
-        light_shader.setMat4("model", model);
-        light_model.draw(light_shader);
-
-        // don't forget to enable shader before setting uniforms
-        object_shader.use();
-        object_shader.setVec3("viewPos", camera.Position);
-        object_shader.setFloat("material.shininess", 64.0f);
-
-        // directional light
-        object_shader.setVec3("dirLight.direction", -0.2f, -1.0f, -0.3f);
-        object_shader.setVec3("dirLight.ambient", 0.05f, 0.05f, 0.05f);
-        object_shader.setVec3("dirLight.diffuse", 0.4f, 0.4f, 0.4f);
-        object_shader.setVec3("dirLight.specular", 0.5f, 0.5f, 0.5f);
-
-        // point light
-        object_shader.setVec3("pointLights[0].position", 0.7f, 0.2f, 2.0f);
-        object_shader.setVec3("pointLights[0].ambient", 0.05f, 0.05f, 0.05f);
-        object_shader.setVec3("pointLights[0].diffuse", 0.8f, 0.8f, 0.8f);
-        object_shader.setVec3("pointLights[0].specular", 1.0f, 1.0f, 1.0f);
-        object_shader.setFloat("pointLights[0].constant", 1.0f);
-        object_shader.setFloat("pointLights[0].linear", 0.09f);
-        object_shader.setFloat("pointLights[0].quadratic", 0.032f);
-
-        // flashlight
-        object_shader.setVec3("spotLight.position", camera.Position);
-        object_shader.setVec3("spotLight.direction", camera.Front);
-        object_shader.setVec3("spotLight.ambient", 0.0f, 0.0f, 0.0f);
-        object_shader.setVec3("spoGL_CULL_FACEtLight.diffuse", 1.0f, 1.0f, 1.0f);
-        object_shader.setVec3("spotLight.specular", 1.0f, 1.0f, 1.0f);
-        object_shader.setFloat("spotLight.constant", 1.0f);
-        object_shader.setFloat("spotLight.linear", 0.09f);
-        object_shader.setFloat("spotLight.quadratic", 0.032f);
-        object_shader.setFloat("spotLight.cutOff", glm::cos(glm::radians(0.0f)));
-        object_shader.setFloat("spotLight.outerCutOff", glm::cos(glm::radians(0.0f)));
-
-        // view/projection transformations
-        object_shader.setMat4("projection", projection);
-        object_shader.setMat4("view", view);
-
-        // render the loaded model
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, glm::vec3(0.0f, 0.0f, 0.0f));
-        model = glm::scale(model, glm::vec3(1.0f, 1.0f, 1.0f));	// it's a bit too big for our scene, so scale it down
-        object_shader.setMat4("model", model);
-        backpack_model.draw(object_shader);
-        model = glm::translate(model, glm::vec3(10.0f, 10.0f, 10.0f));
-        object_shader.setMat4("model", model);
-        //draw_all(object_shader);
-
-        framebuffer.draw();
-
-        // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
-        // -------------------------------------------------------------------------------
+        // one upload per block reaches every program
+        view_uniforms.upload(ring, frame->view);
+        light_uniforms.upload(ring, frame->lights);
+
+        // test the world space box of every mesh of every entity against the frustum in one batch
+        BitForge::BoxList boxes(&render_arena);
+        boxes.reserve(frame->draws.size());
+        for (const DrawItem& draw : frame->draws)
+        {
+            for (const Mesh& mesh : models[draw.model_id].meshes)
+                boxes.push(mesh.bounds, draw.instance.model);
+        }
+        std::span<uint8_t> mesh_visible(render_arena.allocate_array<uint8_t>(boxes.size()), boxes.size());
+        size_t meshes_visible = BitForge::cull_boxes(frame->frustum, boxes, mesh_visible);
+
+        // rasterize the occluders on the job system, then test the boxes that survived the frustum
+        auto occlusion_start = std::chrono::steady_clock::now();
+        std::pmr::vector<BitForge::OccluderInstance> occluders(&render_arena);
+        for (const DrawItem& draw : frame->draws)
+        {
+            if (model_occludes[draw.model_id] && !models[draw.model_id].occluder.empty())
+                occluders.push_back({&models[draw.model_id].occluder, draw.instance.model});
+        }
+        occlusion.render(occluders, frame->view.projection * frame->view.view, BitForge::jobs());
+        std::atomic<size_t> meshes_occluded{0};
+        BitForge::jobs().parallel_for(boxes.size(), 256, [&](size_t begin, size_t end)
+        {
+            size_t occluded = 0;
+            for (size_t i = begin; i < end; i++)
+            {
+                if (!mesh_visible[i])
+                    continue;
+                glm::vec3 min(boxes.min(0)[i], boxes.min(1)[i], boxes.min(2)[i]);
+                glm::vec3 max(boxes.max(0)[i], boxes.max(1)[i], boxes.max(2)[i]);
+                if (!occlusion.visible(min, max))
+                {
+                    mesh_visible[i] = 0;
+                    occluded++;
+                }
+            }
+            meshes_occluded.fetch_add(occluded, std::memory_order_relaxed);
+        });
+        meshes_visible -= meshes_occluded.load(std::memory_order_relaxed);
+        auto occlusion_time = std::chrono::steady_clock::now() - occlusion_start;
+
+        // queue one packet per visible mesh, keyed so equal state ends up adjacent; meshes are visited in
+        // the order their boxes were pushed
+        BitForge::RenderQueue queue(&render_arena);
+        queue.reserve(meshes_visible);
+        for (uint32_t item = 0, box = 0; item < frame->draws.size(); item++)
+        {
+            const DrawItem& draw = frame->draws[item];
+            const Model& model = models[draw.model_id];
+            float distance = -(frame->view.view * draw.instance.model[3]).z;
+            uint32_t depth = BitForge::SortKey::depth(distance, 0.1f, 100.0f);
+            for (uint32_t i = 0; i < model.meshes.size(); i++, box++)
+            {
+                if (!mesh_visible[box])
+                    continue;
+                const Mesh& mesh = model.meshes[i];
+                // materials are selected per draw from the Materials buffer, so they don't split batches;
+                // only whether they cut out or are transparent does. Only the object program has variants
+                // for those, everything else (the light) stays opaque.
+                uint32_t pass = BitForge::PASS_OPAQUE;
+                uint32_t program = draw.shader_id;
+                if (draw.shader_id == SHADER_OBJECT && mesh.material.transparent)
+                {
+                    pass = BitForge::PASS_TRANSPARENT;
+                    program = SHADER_OBJECT_TRANSPARENT;
+                }
+                else if (draw.shader_id == SHADER_OBJECT && mesh.material.alphaTested)
+                {
+                    pass = BitForge::PASS_ALPHA_TESTED;
+                    program = SHADER_OBJECT_ALPHA_TESTED;
+                }
+                queue.push(BitForge::SortKey::make(pass, program, 0, mesh.id, depth), item, i);
+            }
+        }
+        queue.sort();
+
+        // instance data in sorted order, so each run of packets sharing program, material and mesh is one
+        // instanced draw reading its slice of the buffer
+        std::span<const BitForge::DrawPacket> packets = queue.sorted();
+        std::span<BitForge::InstanceData> instance_data = instances.allocate(ring, packets.size());
+        BitForge::jobs().parallel_for(packets.size(), 1024, [&](size_t begin, size_t end)
+        {
+            for (size_t i = begin; i < end; i++)
+                instance_data[i] = frame->draws[packets[i].item].instance;
+        });
+        instances.bind();
+
+        // one indirect command per run, covering the run's slice of the instance buffer; consecutive runs
+        // sharing program and material form a batch that a single multi-draw submits. Culling fills in how
+        // many instances of each run are visible.
+        struct Batch
+        {
+            size_t packet;
+            size_t first_command;
+            size_t command_count;
+        };
+        std::pmr::vector<BitForge::CullCommand> commands(&render_arena);
+        std::pmr::vector<BitForge::InstanceCull> instance_culls(packets.size(), &render_arena);
+        std::pmr::vector<BitForge::DrawData> draw_data(&render_arena);
+        std::pmr::vector<Batch> batches(&render_arena);
+        for (size_t first = 0, last = 0; first < packets.size(); first = last)
+        {
+            const BitForge::DrawPacket& packet = packets[first];
+            for (last = first + 1; last < packets.size() && BitForge::SortKey::state(packets[last].key) == BitForge::SortKey::state(packet.key); last++);
+
+            if (batches.empty() || BitForge::SortKey::batch(packets[batches.back().packet].key) != BitForge::SortKey::batch(packet.key))
+                batches.push_back({first, commands.size(), 0});
+
+            const Mesh& mesh = models[frame->draws[packet.item].model_id].meshes[packet.mesh];
+            for (size_t i = first; i < last; i++)
+                instance_culls[i] = {static_cast<GLuint>(commands.size()), frame->draws[packets[i].item].object};
+            // transparent meshes are drawn once all opaque depth is down, so only by phase 2
+            GLuint late = BitForge::SortKey::pass(packet.key) == BitForge::PASS_TRANSPARENT ? BitForge::CULL_LATE : 0;
+            commands.push_back({mesh.indirectCommand(0, static_cast<GLuint>(first)), static_cast<GLuint>(batches.size() - 1),
+                                static_cast<GLuint>(batches.back().first_command), mesh.id % 32 | late, mesh.bounds.sphere});
+            draw_data.push_back({mesh.material.id, mesh.material.shininess, {0, 0}});
+            batches.back().command_count++;
+        }
+        uint32_t objects = 0;
+        for (const DrawItem& draw : frame->draws)
+            objects = std::max(objects, draw.object + 1);
+        culling.begin(ring, commands, instance_culls, draw_data, batches.size(), objects);
+
+        // Record the draws of every batch once, in parallel: each chunk only binds state that differs from its
+        // previous batch, so the cost of splitting is one program and pass state bind per chunk. Batches are
+        // sorted by pass, opaque ones first, transparent ones last. With the pre-pass, opaque batches are
+        // drawn twice: depth only, then shaded with GL_EQUAL so hidden fragments never run the lighting.
+        auto batches_before = [&](uint32_t pass)
+        {
+            size_t count = 0;
+            while (count < batches.size() && BitForge::SortKey::pass(packets[batches[count].packet].key) < pass)
+                count++;
+            return count;
+        };
+        size_t opaque_batches = batches_before(BitForge::PASS_ALPHA_TESTED);
+        size_t solid_batches = batches_before(BitForge::PASS_TRANSPARENT);
+        auto record = [&](CommandList& list, size_t first, size_t last, bool depth_only)
+        {
+            size_t count = last - first;
+            size_t chunk_size = std::max(MIN_BATCHES_PER_CHUNK, (count + list.buffers.size() - 1) / list.buffers.size());
+            list.chunks = (count + chunk_size - 1) / chunk_size;
+            BitForge::jobs().parallel_for(list.chunks, 1, [&](size_t begin, size_t end)
+            {
+                for (size_t chunk = begin; chunk < end; chunk++)
+                {
+                    BitForge::CommandBuffer& buffer = list.buffers[chunk];
+                    BitForge::DrawState& state = list.states[chunk];
+                    buffer.clear();
+                    state.reset();
+                    for (size_t b = first + chunk * chunk_size; b < std::min(last, first + (chunk + 1) * chunk_size); b++)
+                    {
+                        const Batch& batch = batches[b];
+                        uint64_t key = packets[batch.packet].key;
+                        uint32_t pass = BitForge::SortKey::pass(key);
+                        uint32_t program = BitForge::SortKey::program(key);
+                        const Shader& shader = depth_only ? depth_shader : shaders[program];
+
+                        if (state.change(BitForge::DrawState::PASS, pass))
+                        {
+                            // transparent surfaces are tested against the opaque depth but don't hide each other
+                            bool equal = !depth_only && pass == BitForge::PASS_OPAQUE && frame->depth_prepass;
+                            bool write = !equal && pass != BitForge::PASS_TRANSPARENT;
+                            buffer.record(BitForge::Commands::DepthState{static_cast<GLenum>(equal ? GL_EQUAL : GL_LEQUAL), static_cast<GLboolean>(write ? GL_TRUE : GL_FALSE)});
+                        }
+                        if (state.change(BitForge::DrawState::PROGRAM, shader.ID))
+                            buffer.record(BitForge::Commands::UseProgram{&shader});
+
+                        if (!depth_only)
+                            buffer.record(BitForge::Commands::SetInt{&shader, draw_offset_uniforms[program], static_cast<int>(batch.first_command)});
+                        buffer.record(BitForge::Commands::DrawCulled{&culling, b, batch.first_command, batch.command_count});
+                    }
+                }
+            });
+        };
+        record(prepass_commands, 0, frame->depth_prepass ? opaque_batches : 0, true);
+        record(main_commands, 0, solid_batches, false);
+        record(transparent_commands, solid_batches, batches.size(), false);
+
+        // the frame's targets, transient: allocated from the graph's pool for the passes using them
+        graph.reset();
+        BitForge::ResourceId color_target = graph.create_texture("color", {GL_RGB8, frame->width, frame->height});
+        BitForge::ResourceId depth_target = graph.create_texture("depth", {GL_DEPTH24_STENCIL8, frame->width, frame->height, GL_NEAREST});
+        // weights reach thousands, the sums need floats; revealage only shrinks from 1 towards 0
+        BitForge::ResourceId accum_target = graph.create_texture("accum", {GL_RGBA16F, frame->width, frame->height});
+        BitForge::ResourceId revealage_target = graph.create_texture("revealage", {GL_R8, frame->width, frame->height});
+        BitForge::ResourceId pyramid = graph.import_texture("hi-z", hiz.id(), {GL_R32F, scene_width, scene_height, GL_NEAREST});
+
+        // Render every entity in two phases, replaying the same commands:
+        // 1. what was visible last frame, 2. what the depth of phase 1 does not hide and phase 1 skipped
+        // then blend the transparent surfaces, which only phase 2 culling lets through, over the result.
+        auto draw_phase = [&](int phase)
+        {
+            gl.enable(GL_DEPTH_TEST);
+            culling.cull(ring, phase, hiz);
+            gl.bindVertexArray(staticGeometry().vertexArray());
+            BitForge::materials().bind();
+
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            prepass_commands.execute();
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+            overdraw_queries.begin(phase - 1);
+            main_commands.execute();
+            overdraw_queries.end();
+
+            // the recorded passes leave their depth state behind
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_TRUE);
+        };
+        auto draw_phase_1 = [&](const BitForge::RenderGraph&) { draw_phase(1); };
+        auto draw_phase_2 = [&](const BitForge::RenderGraph&) { draw_phase(2); };
+        auto build_hiz = [&](const BitForge::RenderGraph& g) { hiz.build(g.texture(depth_target)); };
+        auto draw_transparent = [&](const BitForge::RenderGraph&)
+        {
+            // the buffers and bindings phase 2 left are still in place
+            gl.enable(GL_BLEND);
+            glBlendFunci(0, GL_ONE, GL_ONE);
+            glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR);
+            overdraw_queries.begin(2);
+            transparent_commands.execute();
+            overdraw_queries.end();
+            gl.disable(GL_BLEND);
+            glDepthFunc(GL_LEQUAL);
+            glDepthMask(GL_TRUE);
+        };
+        glm::vec2 scene_scale(static_cast<float>(scene_width) / frame->width, static_cast<float>(scene_height) / frame->height);
+        auto composite = [&](const BitForge::RenderGraph& g) { framebuffer.draw(g.texture(color_target), g.texture(accum_target), g.texture(revealage_target), scene_scale); };
+
+        BitForge::PassBuilder phase_1 = graph.add_pass("phase 1", draw_phase_1);
+        phase_1.color(color_target, BitForge::Load::CLEAR, glm::vec4(0.05f, 0.05f, 0.05f, 1.0f));
+        phase_1.depth(depth_target, BitForge::Load::CLEAR);
+        phase_1.render_area(scene_width, scene_height);
+
+        BitForge::PassBuilder hiz_pass = graph.add_pass("hi-z", build_hiz);
+        hiz_pass.sample(depth_target);
+        hiz_pass.write_image(pyramid);
+
+        BitForge::PassBuilder phase_2 = graph.add_pass("phase 2", draw_phase_2);
+        phase_2.sample(pyramid);
+        phase_2.color(color_target, BitForge::Load::LOAD);
+        phase_2.depth(depth_target, BitForge::Load::LOAD);
+        phase_2.render_area(scene_width, scene_height);
+
+        // tested against the opaque depth, but neither writing it nor hiding each other
+        BitForge::PassBuilder transparent = graph.add_pass("transparent", draw_transparent);
+        transparent.color(accum_target, BitForge::Load::CLEAR, glm::vec4(0.0f));
+        transparent.color(revealage_target, BitForge::Load::CLEAR, glm::vec4(1.0f));
+        transparent.depth(depth_target, BitForge::Load::LOAD, 1.0f, false);
+        transparent.render_area(scene_width, scene_height);
+
+        BitForge::PassBuilder to_window = graph.add_pass("composite", composite);
+        to_window.sample(color_target);
+        to_window.sample(accum_target);
+        to_window.sample(revealage_target);
+        to_window.side_effects();
+
+        graph.compile();
+        frame_timer.begin(0);
+        graph.execute();
+        frame_timer.end();
+        overdraw_queries.end_frame();
+        if (frame_timer.end_frame())
+            resolution.update(frame_timer.results()[0] / 1e6);
+
+        // everything reading this frame's region is submitted
+        ring.end_frame();
+
+        BitForge::RenderStats& stats = BitForge::render_stats();
+        stats.uniform_lookups.store(Shader::lookups.exchange(0), std::memory_order_relaxed);
+        stats.meshes_tested.store(static_cast<unsigned int>(boxes.size()), std::memory_order_relaxed);
+        stats.meshes_culled.store(static_cast<unsigned int>(boxes.size() - meshes_visible - meshes_occluded.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        stats.meshes_occluded.store(static_cast<unsigned int>(meshes_occluded.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+        stats.occluder_triangles.store(static_cast<unsigned int>(occlusion.triangles_rasterized()), std::memory_order_relaxed);
+        stats.occlusion_us.store(static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::microseconds>(occlusion_time).count()), std::memory_order_relaxed);
+        stats.draw_packets.store(static_cast<unsigned int>(queue.size()), std::memory_order_relaxed);
+        stats.draw_commands.store(static_cast<unsigned int>(commands.size()), std::memory_order_relaxed);
+        stats.draw_calls.store(static_cast<unsigned int>((solid_batches + (frame->depth_prepass ? opaque_batches : 0)) * 2 + batches.size() - solid_batches), std::memory_order_relaxed);
+        // the recorded binds are issued once per phase, the transparent ones only in phase 2
+        unsigned int changes = 0, saved = 0;
+        for (const CommandList* list : {&prepass_commands, &main_commands, &transparent_commands})
+        {
+            unsigned int replays = list == &transparent_commands ? 1 : 2;
+            for (size_t chunk = 0; chunk < list->chunks; chunk++)
+            {
+                for (int slot = 0; slot < BitForge::DrawState::SLOT_COUNT; slot++)
+                {
+                    changes += replays * list->states[chunk].bind_count(static_cast<BitForge::DrawState::Slot>(slot));
+                    saved += replays * list->states[chunk].saved_count(static_cast<BitForge::DrawState::Slot>(slot));
+                }
+            }
+        }
+        stats.state_changes.store(changes, std::memory_order_relaxed);
+        stats.state_changes_saved.store(saved, std::memory_order_relaxed);
+        stats.gl_calls.store(gl.calls_issued(), std::memory_order_relaxed);
+        stats.gl_calls_elided.store(gl.calls_elided(), std::memory_order_relaxed);
+        gl.reset_counters();
+        stats.resolution_percent.store(static_cast<unsigned int>(resolution.scale() * 100.0f + 0.5f), std::memory_order_relaxed);
+        stats.gpu_frame_us.store(static_cast<unsigned int>(resolution.gpu_ms() * 1000.0), std::memory_order_relaxed);
+        stats.render_target_kb.store(static_cast<unsigned int>(graph.allocated_bytes() / 1024), std::memory_order_relaxed);
+        // the queries come back a few frames late, close enough for a size that rarely changes
+        if (overdraw_queries.ready())
+        {
+            GLuint64 fragments = 0;
+            for (GLuint64 count : overdraw_queries.results())
+                fragments += count;
+            double pixels = std::max(1.0, static_cast<double>(scene_width) * scene_height);
+            stats.overdraw_percent.store(static_cast<unsigned int>(fragments * 100.0 / pixels), std::memory_order_relaxed);
+        }
+
+        queue.clear();
+        render_arena.reset();
+
+        // the snapshot is no longer needed once everything is submitted, let the simulation reuse it
+        frames->end_read();
+
+        // glfw: swap buffers
+        // ------------------
         glfwSwapBuffers(window);
-        glfwPollEvents();
     }
-
-    framebuffer.cleanUp();
-
-    // glfw: terminate, clearing all previously allocated GLFW resources.
-    // ------------------------------------------------------------------
-    glfwTerminate();
-    return 0;
 }
 
 void process_input(GLFWwindow* window)
@@ -234,16 +728,17 @@ void process_input(GLFWwindow* window)
         camera.ProcessKeyboard(LEFT, delta_time);
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, delta_time);
+
+    bool prepass_key = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (prepass_key && !prepass_key_down)
+        depth_prepass = !depth_prepass;
+    prepass_key_down = prepass_key;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    // make sure the viewport matches the new window dimensions; note that width and 
-    // height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
-    Framebuffer* fb = static_cast<Framebuffer*>(glfwGetWindowUserPointer(window));
-    if (fb) fb->resize(width, height);
-
+    // the render thread picks the new size up from the next snapshot and resizes the viewport there; note that
+    // width and height will be significantly larger than specified on retina displays.
     scr_width = width;
     scr_height = height;
 }
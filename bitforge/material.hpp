@@ -0,0 +1,63 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h>
+
+#include <shader.hpp>
+
+#include <array>
+
+// texture kinds a material can carry
+enum TextureSlot : unsigned int {
+    TEXTURE_DIFFUSE,
+    TEXTURE_SPECULAR,
+    TEXTURE_NORMAL,
+    TEXTURE_HEIGHT,
+    TEXTURE_SLOT_COUNT
+};
+
+// Everything a mesh needs to be shaded, resolved once at import: the texture of each slot and scalar
+// parameters. Textures are packed into texture array layers by the MaterialLibrary (see
+// materiallibrary.hpp), which also puts every material into the Materials storage buffer, so a draw
+// selects its material by index instead of binding textures. The uniform handle is resolved the first
+// time the material is bound with a program, so binding never touches a string.
+class Material
+{
+public:
+    // unique across all models, indexes the Materials buffer
+    unsigned int id = 0;
+    float shininess = 64.0f;
+    // library texture per slot, -1 for none
+    std::array<GLint, TEXTURE_SLOT_COUNT> textures = {-1, -1, -1, -1};
+    // scales the diffuse alpha, below 1 only for transparent materials
+    float opacity = 1.0f;
+    // the diffuse texture has cut out texels: drawn in the alpha tested pass, with discard and
+    // without the depth pre-pass; everything else is opaque and never discards
+    bool alphaTested = false;
+    // see-through: blended in the transparent pass, after everything opaque, in any order
+    bool transparent = false;
+
+    void setTexture(TextureSlot slot, GLint texture)
+    {
+        textures[slot] = texture;
+    }
+
+    // selects the material for the draws that follow, shader must be in use; only needed by variants
+    // without per-draw data, INDIRECT draws read the material of their DrawData
+    void bind(const Shader& shader)
+    {
+        if (program != shader.ID)
+        {
+            indexHandle = shader.uniform("materialIndex");
+            program = shader.ID;
+        }
+        shader.setInt(indexHandle, static_cast<int>(id));
+    }
+
+private:
+    // handle of the program this material was last bound with
+    GLuint program = 0;
+    UniformHandle indexHandle;
+};
+
+#endif
@@ -0,0 +1,223 @@
+#ifndef MATERIALLIBRARY_H
+#define MATERIALLIBRARY_H
+
+#include <glad/glad.h>
+#include <stb/stb_image.h>
+
+#include <glresource.hpp>
+#include <glstate.hpp>
+#include <material.hpp>
+#include <uniformblocks.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace BitForge {
+    // units of the sampler2DArray materialArrays[] in default.frag, just below HIZ_TEXTURE_UNIT
+    const GLuint MAX_MATERIAL_ARRAYS = 8;
+
+    // A material as default.frag reads it from the Materials buffer (std430). Each texture is the array
+    // index shifted left by 16 plus the layer, or -1 for none.
+    struct MaterialData {
+        GLint textures[TEXTURE_SLOT_COUNT];
+        float shininess;
+        float opacity; // scales the diffuse alpha of transparent materials
+        float padding[2];
+    };
+
+    static_assert(sizeof(MaterialData) == 32);
+
+    // Every material texture of every model, packed into a few GL_TEXTURE_2D_ARRAYs, and every material
+    // in one storage buffer. Images are decoded as RGBA8 when a model is imported and kept on the CPU
+    // until build(), which groups them by size, one array per size with one layer per image. Draws then
+    // differ only in the material index they read, so meshes with different textures share a program,
+    // a set of bindings and thus a multi-draw, without bindless textures.
+    //
+    // At most MAX_MATERIAL_ARRAYS sizes get their own array; images of rarer sizes are resampled into
+    // the array holding the most layers.
+    class MaterialLibrary {
+    public:
+        // decodes an image file once per path; the texture to store in a Material, -1 when it cannot be loaded
+        GLint add_texture(const std::string& path) {
+            auto it = paths.find(path);
+            if (it != paths.end())
+                return it->second;
+
+            GLint texture = -1;
+            int width, height, components;
+            unsigned char* data = stbi_load(path.c_str(), &width, &height, &components, 4);
+            if (data) {
+                texture = static_cast<GLint>(images.size());
+                images.push_back({width, height, std::vector<unsigned char>(data, data + static_cast<size_t>(width) * height * 4)});
+                cutouts.push_back(cuts_out(images.back()));
+                translucents.push_back(translucent(images.back()));
+            } else {
+                std::cout << "Texture failed to load at path: " << path << std::endl;
+            }
+            stbi_image_free(data);
+            paths.emplace(path, texture);
+            return texture;
+        }
+
+        // whether a texture has texels default.frag's ALPHA_TEST variant discards, false for -1
+        bool cutout(GLint texture) const {
+            return texture >= 0 && cutouts[texture];
+        }
+
+        // whether a texture is largely see-through rather than cut out, false for -1
+        bool translucent(GLint texture) const {
+            return texture >= 0 && translucents[texture];
+        }
+
+        // records a material's textures and parameters under its id; adding an id again replaces it
+        void add(const Material& material) {
+            if (material.id >= records.size())
+                records.resize(material.id + 1, {{-1, -1, -1, -1}, 64.0f, 1.0f, {0.0f, 0.0f}});
+            MaterialData& record = records[material.id];
+            std::copy(material.textures.begin(), material.textures.end(), record.textures);
+            record.shininess = material.shininess;
+            record.opacity = material.opacity;
+        }
+
+        // packs the images loaded so far into texture arrays and uploads every material; call once all
+        // models are loaded, on the thread owning the GL context. The CPU copies of the images are freed.
+        void build() {
+            // sizes by number of images, most common first
+            std::map<std::pair<int, int>, std::vector<size_t>> by_size;
+            for (size_t i = 0; i < images.size(); i++)
+                by_size[{images[i].width, images[i].height}].push_back(i);
+            std::vector<std::pair<std::pair<int, int>, std::vector<size_t>>> groups(by_size.begin(), by_size.end());
+            std::stable_sort(groups.begin(), groups.end(), [](const auto& a, const auto& b) { return a.second.size() > b.second.size(); });
+
+            // fold the rarest sizes into the biggest array
+            for (size_t g = MAX_MATERIAL_ARRAYS; g < groups.size(); g++) {
+                auto [width, height] = groups[0].first;
+                for (size_t i : groups[g].second) {
+                    images[i] = resample(images[i], width, height);
+                    groups[0].second.push_back(i);
+                }
+            }
+            groups.resize(std::min<size_t>(groups.size(), MAX_MATERIAL_ARRAYS));
+
+            std::vector<GLint> packed(images.size(), -1);
+            arrays.clear();
+            for (size_t g = 0; g < groups.size(); g++) {
+                auto [width, height] = groups[g].first;
+                const std::vector<size_t>& members = groups[g].second;
+                GLsizei levels = static_cast<GLsizei>(std::bit_width(static_cast<unsigned int>(std::max(width, height))));
+                TextureHandle array = create_texture_2d_array(GL_RGBA8, width, height, static_cast<GLsizei>(members.size()), levels);
+                for (size_t layer = 0; layer < members.size(); layer++) {
+                    glTextureSubImage3D(array.get(), 0, 0, 0, static_cast<GLint>(layer), width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE,
+                                        images[members[layer]].pixels.data());
+                    packed[members[layer]] = static_cast<GLint>(g << 16 | layer);
+                }
+                glGenerateTextureMipmap(array.get());
+                glTextureParameteri(array.get(), GL_TEXTURE_WRAP_S, GL_REPEAT);
+                glTextureParameteri(array.get(), GL_TEXTURE_WRAP_T, GL_REPEAT);
+                glTextureParameteri(array.get(), GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                glTextureParameteri(array.get(), GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+                arrays.push_back(std::move(array));
+            }
+
+            std::vector<MaterialData> data = records;
+            for (MaterialData& material : data) {
+                for (GLint& texture : material.textures)
+                    texture = texture >= 0 ? packed[texture] : -1;
+            }
+            if (data.empty())
+                data.push_back({{-1, -1, -1, -1}, 64.0f, 1.0f, {0.0f, 0.0f}});
+            buffer = create_buffer(data.size() * sizeof(MaterialData), data.data());
+
+            std::vector<Image>().swap(images);
+        }
+
+        // binds the arrays to units 0 to MAX_MATERIAL_ARRAYS - 1 and the materials to MATERIAL_BINDING
+        void bind() const {
+            GLState& state = gl_state();
+            for (size_t i = 0; i < arrays.size(); i++)
+                state.bindTexture(static_cast<GLuint>(i), GL_TEXTURE_2D_ARRAY, arrays[i].get());
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_BINDING, buffer.get());
+        }
+
+        size_t array_count() const { return arrays.size(); }
+        size_t material_count() const { return records.size(); }
+
+    private:
+        struct Image {
+            int width, height;
+            std::vector<unsigned char> pixels; // RGBA8, rows bottom up as stb_image is set to flip them
+        };
+
+        std::unordered_map<std::string, GLint> paths;
+        std::vector<Image> images;
+        std::vector<uint8_t> cutouts; // per texture, kept after build()
+        std::vector<uint8_t> translucents;
+        std::vector<MaterialData> records;
+        std::vector<TextureHandle> arrays;
+        BufferHandle buffer;
+
+        // alpha at or below 0.05, the discard threshold of default.frag
+        static bool cuts_out(const Image& image) {
+            for (size_t i = 3; i < image.pixels.size(); i += 4) {
+                if (image.pixels[i] <= 12)
+                    return true;
+            }
+            return false;
+        }
+
+        // a quarter or more of the texels partially transparent: glass, smoke, ... rather than the soft
+        // edges of a cut out texture
+        static bool translucent(const Image& image) {
+            size_t partial = 0;
+            for (size_t i = 3; i < image.pixels.size(); i += 4) {
+                if (image.pixels[i] > 12 && image.pixels[i] < 243)
+                    partial++;
+            }
+            size_t texels = image.pixels.size() / 4;
+            return texels > 0 && partial * 4 >= texels;
+        }
+
+        // bilinear, texel centers aligned, wrapping like the REPEAT sampler
+        static Image resample(const Image& image, int width, int height) {
+            Image result{width, height, std::vector<unsigned char>(static_cast<size_t>(width) * height * 4)};
+            auto texel = [&](int x, int y, int channel) {
+                x = (x % image.width + image.width) % image.width;
+                y = (y % image.height + image.height) % image.height;
+                return static_cast<float>(image.pixels[(static_cast<size_t>(y) * image.width + x) * 4 + channel]);
+            };
+            for (int y = 0; y < height; y++) {
+                float v = (y + 0.5f) * image.height / height - 0.5f;
+                int y0 = static_cast<int>(std::floor(v));
+                float fy = v - y0;
+                for (int x = 0; x < width; x++) {
+                    float u = (x + 0.5f) * image.width / width - 0.5f;
+                    int x0 = static_cast<int>(std::floor(u));
+                    float fx = u - x0;
+                    for (int c = 0; c < 4; c++) {
+                        float top = texel(x0, y0, c) * (1.0f - fx) + texel(x0 + 1, y0, c) * fx;
+                        float bottom = texel(x0, y0 + 1, c) * (1.0f - fx) + texel(x0 + 1, y0 + 1, c) * fx;
+                        result.pixels[(static_cast<size_t>(y) * width + x) * 4 + c] = static_cast<unsigned char>(top * (1.0f - fy) + bottom * fy + 0.5f);
+                    }
+                }
+            }
+            return result;
+        }
+    };
+
+    // the textures and materials of every model, never destroyed for the same reason as staticGeometry()
+    inline MaterialLibrary& materials() {
+        static MaterialLibrary& library = *new MaterialLibrary();
+        return library;
+    }
+}
+
+#endif
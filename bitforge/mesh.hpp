@@ -6,9 +6,15 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <frustum.hpp>
+#include <geometrybuffer.hpp>
+#include <glstate.hpp>
+#include <material.hpp>
 #include <shader.hpp>
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -31,116 +37,147 @@ struct Vertex {
 	float m_Weights[MAX_BONE_INFLUENCE];
 };
 
-struct Texture {
-    unsigned int id;
-    string type;
-    string path;
-};
+// attribute layout of Vertex, declared on vertex_array for vertex buffer binding 0
+inline void setupVertexFormat(GLuint vertex_array)
+{
+    // vertex Positions
+    glEnableVertexArrayAttrib(vertex_array, 0);
+    glVertexArrayAttribFormat(vertex_array, 0, 3, GL_FLOAT, GL_FALSE, 0);
+    // vertex normals
+    glEnableVertexArrayAttrib(vertex_array, 1);
+    glVertexArrayAttribFormat(vertex_array, 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Normal));
+    // vertex texture coords
+    glEnableVertexArrayAttrib(vertex_array, 2);
+    glVertexArrayAttribFormat(vertex_array, 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, TexCoords));
+    // vertex tangent
+    glEnableVertexArrayAttrib(vertex_array, 3);
+    glVertexArrayAttribFormat(vertex_array, 3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Tangent));
+    // vertex bitangent
+    glEnableVertexArrayAttrib(vertex_array, 4);
+    glVertexArrayAttribFormat(vertex_array, 4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, Bitangent));
+	// ids
+	glEnableVertexArrayAttrib(vertex_array, 5);
+	glVertexArrayAttribIFormat(vertex_array, 5, 4, GL_INT, offsetof(Vertex, m_BoneIDs));
+	// weights
+	glEnableVertexArrayAttrib(vertex_array, 6);
+	glVertexArrayAttribFormat(vertex_array, 6, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, m_Weights));
+
+    for (GLuint attribute = 0; attribute <= 6; attribute++)
+        glVertexArrayAttribBinding(vertex_array, attribute, 0);
+}
+
+// the buffers every static mesh lives in, created on first use by the thread owning the GL context;
+// never destroyed, the buffers go away with the context rather than at exit when no context is current
+inline BitForge::GeometryBuffer& staticGeometry()
+{
+    static BitForge::GeometryBuffer& geometry = *new BitForge::GeometryBuffer(sizeof(Vertex), setupVertexFormat);
+    return geometry;
+}
 
 class Mesh {
 public:
     // mesh Data
     vector<Vertex>       vertices;
     vector<unsigned int> indices;
-    vector<Texture>      textures;
-    unsigned int VAO;
+    Material             material;
+    // unique across all meshes, used to sort and batch draws
+    unsigned int id;
+    // where this mesh's vertices and indices live in the shared buffers
+    BitForge::GeometryRange geometry;
+    // object space box and sphere around every vertex, for culling
+    BitForge::Bounds bounds;
+
+    inline static unsigned int meshCount = 0;
 
     // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, Material material, BitForge::Bounds bounds)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->material = material;
+        this->bounds = bounds;
+        id = meshCount++;
 
-        // now that we have all the required data, set the vertex buffers and its attribute pointers.
+        // now that we have all the required data, copy it into the shared buffers.
         setupMesh();
     }
 
-    // render the mesh
-    void draw(Shader& shader) 
+    // a mesh owns its range of the shared buffers, so it can be moved but not copied
+    Mesh(Mesh&& other) noexcept
+        : vertices(std::move(other.vertices)), indices(std::move(other.indices)), material(other.material), id(other.id),
+          geometry(std::exchange(other.geometry, {})), bounds(other.bounds)
+    {
+    }
+
+    Mesh& operator=(Mesh&& other) noexcept
     {
-        // bind appropriate textures
-        unsigned int diffuseNr  = 1;
-        unsigned int specularNr = 1;
-        unsigned int normalNr   = 1;
-        unsigned int heightNr   = 1;
-        for(unsigned int i = 0; i < textures.size(); i++)
+        if (this != &other)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
-            // retrieve texture number (the N in diffuse_textureN)
-            string number;
-            string name = textures[i].type;
-            if(name == "texture_diffuse")
-                number = std::to_string(diffuseNr++);
-            else if(name == "texture_specular")
-                number = std::to_string(specularNr++); // transfer unsigned int to string
-            else if(name == "texture_normal")
-                number = std::to_string(normalNr++); // transfer unsigned int to string
-            else if(name == "texture_height")
-                number = std::to_string(heightNr++); // transfer unsigned int to string
-
-            // now set the sampler to the correct texture unit
-            shader.setInt(("material." + name.erase(0,8)).c_str(), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            staticGeometry().remove(geometry);
+            vertices = std::move(other.vertices);
+            indices = std::move(other.indices);
+            material = other.material;
+            id = other.id;
+            geometry = std::exchange(other.geometry, {});
+            bounds = other.bounds;
         }
-        
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        return *this;
+    }
+
+    Mesh(const Mesh&) = delete;
+    Mesh& operator=(const Mesh&) = delete;
+
+    // gives the range back, a moved-from mesh holds an empty one
+    ~Mesh()
+    {
+        staticGeometry().remove(geometry);
+    }
+
+    // render the mesh
+    void draw(Shader& shader)
+    {
+        material.bind(shader);
+        bindVertexArray();
+        drawElements();
+    }
+
+    // the vertex array shared by all static meshes, see staticGeometry()
+    void bindVertexArray() const
+    {
+        BitForge::gl_state().bindVertexArray(staticGeometry().vertexArray());
+    }
+
+    void drawElements() const
+    {
+        glDrawElementsBaseVertex(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, indexOffset(), geometry.baseVertex);
+    }
+
+    // count instances in one call, the INSTANCED shader variants read instance baseInstance + gl_InstanceID
+    void drawInstanced(GLsizei count, GLuint baseInstance = 0) const
+    {
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, geometry.indexCount, GL_UNSIGNED_INT, indexOffset(), count, geometry.baseVertex, baseInstance);
+    }
+
+    // the same draw as drawInstanced, as a record for glMultiDrawElementsIndirect
+    BitForge::DrawElementsIndirectCommand indirectCommand(GLuint count, GLuint baseInstance) const
+    {
+        return { geometry.indexCount, count, geometry.firstIndex, geometry.baseVertex, baseInstance };
     }
 
 private:
-    // render data 
-    unsigned int VBO, EBO;
+    const void* indexOffset() const
+    {
+        return reinterpret_cast<const void*>(static_cast<uintptr_t>(geometry.firstIndex) * sizeof(unsigned int));
+    }
 
-    // initializes all the buffer objects/arrays
+    // suballocates the mesh from the shared vertex and index buffers
     void setupMesh()
     {
-        // create buffers/arrays
-        glGenVertexArrays(1, &VAO);
-        glGenBuffers(1, &VBO);
-        glGenBuffers(1, &EBO);
-
-        glBindVertexArray(VAO);
-        // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        BitForge::GeometryBuffer& buffer = staticGeometry();
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);  
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
-
-        // set the vertex attribute pointers
-        // vertex Positions
-        glEnableVertexAttribArray(0);	
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
-        // vertex normals
-        glEnableVertexAttribArray(1);	
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
-        // vertex texture coords
-        glEnableVertexAttribArray(2);	
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
-        // vertex tangent
-        glEnableVertexAttribArray(3);
-        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
-        // vertex bitangent
-        glEnableVertexAttribArray(4);
-        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
-		// ids
-		glEnableVertexAttribArray(5);
-		glVertexAttribIPointer(5, 4, GL_INT, sizeof(Vertex), (void*)offsetof(Vertex, m_BoneIDs));
-
-		// weights
-		glEnableVertexAttribArray(6);
-		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        geometry = buffer.add(vertices.data(), vertices.size(), indices.data(), indices.size());
     }
 };
 #endif
\ No newline at end of file
@@ -6,21 +6,30 @@
 #include <assimp/postprocess.h>
 #include <stb/stb_image.h>
 
+#include <instancebatch.hpp>
+#include <material.hpp>
+#include <materiallibrary.hpp>
 #include <mesh.hpp>
+#include <occlusionbuffer.hpp>
 #include <shader.hpp>
 
-using namespace std;
+#include <algorithm>
+#include <filesystem>
+#include <unordered_map>
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+using namespace std;
 
 class Model 
 {
 public:
     // model data 
-    vector<Texture> textures_loaded;
     vector<Mesh> meshes;
+    // stands in for the model in software occlusion culling, see loadOccluder()
+    BitForge::Occluder occluder;
     string directory;
     bool gammaCorrection;
+    // material ids are unique across all models, each model takes one per assimp material
+    inline static unsigned int materialCount = 0;
 
     Model(){};
 
@@ -28,6 +37,7 @@ public:
     Model(string const &name, bool gamma = false) : gammaCorrection(gamma)
     {
         loadModel("resources/models/" + name + "/" + name + ".obj");
+        loadOccluder("resources/models/" + name + "/occluder.obj");
     }
 
     // draws the model, and thus all its meshes
@@ -36,8 +46,23 @@ public:
         for(unsigned int i = 0; i < meshes.size(); i++)
             meshes[i].draw(shader);
     }
+
+    // draws every instance of the batch with one call per mesh, shader must be an INSTANCED variant
+    void drawInstanced(Shader& shader, const BitForge::InstanceBatch& batch)
+    {
+        batch.bind();
+        shader.use();
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            meshes[i].material.bind(shader);
+            meshes[i].bindVertexArray();
+            meshes[i].drawInstanced(batch.size());
+        }
+    }
     
 private:
+    unsigned int materialBase = 0;
+
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
     {
@@ -52,15 +77,63 @@ private:
         }
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
+        materialBase = materialCount;
+        materialCount += scene->mNumMaterials;
 
         // process ASSIMP's root node recursively
         processNode(scene->mRootNode, scene);
     }
 
+    // an authored occluder when the model comes with one, otherwise one generated from the opaque meshes
+    void loadOccluder(string const &path)
+    {
+        const unsigned int cells = 16;
+        vector<glm::vec3> positions;
+        vector<uint32_t> indices;
+
+        if (std::filesystem::exists(path))
+        {
+            Assimp::Importer importer;
+            const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+            if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)
+            {
+                cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
+                return;
+            }
+            for (unsigned int m = 0; m < scene->mNumMeshes; m++)
+            {
+                const aiMesh* mesh = scene->mMeshes[m];
+                uint32_t base = static_cast<uint32_t>(occluder.positions.size());
+                for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+                    occluder.positions.push_back(glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z));
+                for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+                {
+                    for (unsigned int j = 0; j < mesh->mFaces[i].mNumIndices; j++)
+                        occluder.indices.push_back(base + mesh->mFaces[i].mIndices[j]);
+                }
+            }
+            return;
+        }
+
+        // see-through and cut out surfaces don't hide what is behind them everywhere
+        for (const Mesh& mesh : meshes)
+        {
+            if (mesh.material.transparent || mesh.material.alphaTested)
+                continue;
+            uint32_t base = static_cast<uint32_t>(positions.size());
+            for (const Vertex& vertex : mesh.vertices)
+                positions.push_back(vertex.Position);
+            for (unsigned int index : mesh.indices)
+                indices.push_back(base + index);
+        }
+        occluder = BitForge::Occluder::cluster(positions, indices, cells);
+    }
+
     // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
     void processNode(aiNode *node, const aiScene *scene)
     {
         // process each mesh located at the current node
+        meshes.reserve(meshes.size() + node->mNumMeshes);
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene. 
@@ -81,7 +154,13 @@ private:
         // data to fill
         vector<Vertex> vertices;
         vector<unsigned int> indices;
-        vector<Texture> textures;
+        // sizes are known up front, so fill without regrowing
+        vertices.reserve(mesh->mNumVertices);
+        indices.reserve(mesh->mNumFaces * 3);
+        // bounding box grown vertex by vertex, for culling
+        BitForge::Bounds bounds;
+        if (mesh->mNumVertices > 0)
+            bounds.min = bounds.max = glm::vec3(mesh->mVertices[0].x, mesh->mVertices[0].y, mesh->mVertices[0].z);
 
         // walk through each of the mesh's vertices
         for(unsigned int i = 0; i < mesh->mNumVertices; i++)
@@ -93,6 +172,8 @@ private:
             vector.y = mesh->mVertices[i].y;
             vector.z = mesh->mVertices[i].z;
             vertex.Position = vector;
+            bounds.min = glm::min(bounds.min, vector);
+            bounds.max = glm::max(bounds.max, vector);
             // normals
             if (mesh->HasNormals())
             {
@@ -129,109 +210,56 @@ private:
         // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
         for(unsigned int i = 0; i < mesh->mNumFaces; i++)
         {
-            aiFace face = mesh->mFaces[i];
+            const aiFace& face = mesh->mFaces[i];
             // retrieve all indices of the face and store them in the indices vector
             for(unsigned int j = 0; j < face.mNumIndices; j++)
                 indices.push_back(face.mIndices[j]);        
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];    
-        // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
-        // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER. 
-        // Same applies to other texture as the following list summarizes:
-        // diffuse: texture_diffuseN
-        // specular: texture_specularN
-        // normal: texture_normalN
-
-        // 1. diffuse maps
-        vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
-        textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
-        // 2. specular maps
-        vector<Texture> specularMaps = loadMaterialTextures(material, aiTextureType_SPECULAR, "texture_specular");
-        textures.insert(textures.end(), specularMaps.begin(), specularMaps.end());
-        // 3. normal maps
-        std::vector<Texture> normalMaps = loadMaterialTextures(material, aiTextureType_HEIGHT, "texture_normal");
-        textures.insert(textures.end(), normalMaps.begin(), normalMaps.end());
-        // 4. height maps
-        std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
-        textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-        
+        // the sphere is centered on the box, not minimal but it only takes a second pass over the positions
+        glm::vec3 center = (bounds.min + bounds.max) * 0.5f;
+        float radius = 0.0f;
+        for (const Vertex& vertex : vertices)
+            radius = glm::max(radius, glm::length(vertex.Position - center));
+        bounds.sphere = glm::vec4(center, radius);
         // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
+        return Mesh(std::move(vertices), std::move(indices), loadMaterial(scene->mMaterials[mesh->mMaterialIndex], mesh->mMaterialIndex), bounds);
     }
 
-    // checks all material textures of a given type and loads the textures if they're not loaded yet.
-    // the required info is returned as a Texture struct.
-    vector<Texture> loadMaterialTextures(aiMaterial *mat, aiTextureType type, string typeName)
+    // resolves everything a material binds at draw time: one texture per slot and the scalar parameters
+    Material loadMaterial(aiMaterial *mat, unsigned int index)
     {
-        vector<Texture> textures;
-        for(unsigned int i = 0; i < mat->GetTextureCount(type); i++)
+        Material material;
+        material.id = materialBase + index;
+
+        // obj files put bump maps in map_Bump, which assimp reports as height; ambient maps stand in for height
+        const aiTextureType types[TEXTURE_SLOT_COUNT] = { aiTextureType_DIFFUSE, aiTextureType_SPECULAR, aiTextureType_HEIGHT, aiTextureType_AMBIENT };
+        for (unsigned int slot = 0; slot < TEXTURE_SLOT_COUNT; slot++)
         {
+            // a slot samples one texture, extra textures of the same type were never visible
+            if (mat->GetTextureCount(types[slot]) == 0)
+                continue;
             aiString str;
-            mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecessary load duplicate textures.
-            }
+            mat->GetTexture(types[slot], 0, &str);
+            material.setTexture(static_cast<TextureSlot>(slot), loadTexture(str.C_Str()));
         }
-        return textures;
-    }
-};
-
-
-inline unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
-{
-    string filename = string(path);
-    filename = directory + '/' + filename;
 
-    unsigned int textureID;
-    glGenTextures(1, &textureID);
-
-    int width, height, nrComponents;
-    unsigned char *data = stbi_load(filename.c_str(), &width, &height, &nrComponents, 0);
-    if (data)
-    {
-        GLenum format;
-        if (nrComponents == 1)
-            format = GL_RED;
-        else if (nrComponents == 3)
-            format = GL_RGB;
-        else if (nrComponents == 4)
-            format = GL_RGBA;
-
-        glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        float shininess = 0.0f;
+        if (mat->Get(AI_MATKEY_SHININESS, shininess) == aiReturn_SUCCESS && shininess > 0.0f)
+            material.shininess = shininess;
+        float opacity = 1.0f;
+        if (mat->Get(AI_MATKEY_OPACITY, opacity) == aiReturn_SUCCESS)
+            material.opacity = std::clamp(opacity, 0.0f, 1.0f);
+        // the transparent pass blends cut out texels away as well, so a material is one or the other
+        material.transparent = material.opacity < 1.0f || BitForge::materials().translucent(material.textures[TEXTURE_DIFFUSE]);
+        material.alphaTested = !material.transparent && BitForge::materials().cutout(material.textures[TEXTURE_DIFFUSE]);
+        BitForge::materials().add(material);
+        return material;
     }
-    else
+
+    // decodes a texture of this model into the material library, which shares it between meshes and models
+    GLint loadTexture(const char *path)
     {
-        std::cout << "Texture failed to load at path: " << path << std::endl;
-        stbi_image_free(data);
+        return BitForge::materials().add_texture(this->directory + '/' + path);
     }
-
-    return textureID;
-}
+};
 #endif
\ No newline at end of file
@@ -0,0 +1,350 @@
+#ifndef OCCLUSIONBUFFER_H
+#define OCCLUSIONBUFFER_H
+
+#include <glm/glm.hpp>
+
+#include <cpufeatures.hpp>
+#include <jobsystem.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace BitForge {
+    // A few triangles standing in for a model when it hides other things, object space, counter
+    // clockwise front faces. It should stay inside the real surface: an occluder poking out of it
+    // hides things that are actually visible.
+    struct Occluder {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> indices;
+
+        bool empty() const { return indices.empty(); }
+
+        // Simplifies a mesh by vertex clustering: positions are snapped to a grid of cells^3 cells
+        // over their bounding box, every cell is replaced by the average of its vertices and triangles
+        // that collapse are dropped. Averaging can move the surface outwards by up to half a cell, so
+        // every vertex is then pulled back along its normal by half a cell diagonal, and triangles the
+        // pull turns around (parts thinner than a cell) are dropped, keeping the result inside the mesh.
+        static Occluder cluster(std::span<const glm::vec3> positions, std::span<const uint32_t> indices, unsigned int cells) {
+            Occluder occluder;
+            if (positions.empty())
+                return occluder;
+
+            glm::vec3 minimum = positions[0], maximum = positions[0];
+            for (const glm::vec3& position : positions) {
+                minimum = glm::min(minimum, position);
+                maximum = glm::max(maximum, position);
+            }
+            glm::vec3 scale = float(cells) / glm::max(maximum - minimum, glm::vec3(1e-6f));
+
+            // cell of every vertex, cells numbered in order of first use
+            std::unordered_map<uint32_t, uint32_t> cell_index;
+            std::vector<uint32_t> remap(positions.size());
+            std::vector<glm::vec3> sums;
+            std::vector<float> counts;
+            for (size_t i = 0; i < positions.size(); i++) {
+                glm::uvec3 cell = glm::min(glm::uvec3((positions[i] - minimum) * scale), glm::uvec3(cells - 1));
+                uint32_t key = (cell.z * cells + cell.y) * cells + cell.x;
+                auto [it, inserted] = cell_index.try_emplace(key, static_cast<uint32_t>(sums.size()));
+                if (inserted) {
+                    sums.push_back(glm::vec3(0.0f));
+                    counts.push_back(0.0f);
+                }
+                sums[it->second] += positions[i];
+                counts[it->second] += 1.0f;
+                remap[i] = it->second;
+            }
+            std::vector<glm::vec3> clustered(sums.size());
+            for (size_t i = 0; i < sums.size(); i++)
+                clustered[i] = sums[i] / counts[i];
+
+            // area weighted normals of the clustered surface
+            std::vector<uint32_t> kept;
+            std::vector<glm::vec3> normals(clustered.size(), glm::vec3(0.0f));
+            for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+                uint32_t a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+                if (a == b || b == c || a == c)
+                    continue;
+                glm::vec3 normal = glm::cross(clustered[b] - clustered[a], clustered[c] - clustered[a]);
+                normals[a] += normal;
+                normals[b] += normal;
+                normals[c] += normal;
+                kept.insert(kept.end(), {a, b, c});
+            }
+
+            float erode = 0.5f * glm::length(1.0f / scale);
+            occluder.positions.resize(clustered.size());
+            for (size_t i = 0; i < clustered.size(); i++) {
+                float length = glm::length(normals[i]);
+                occluder.positions[i] = length > 0.0f ? clustered[i] - normals[i] * (erode / length) : clustered[i];
+            }
+
+            for (size_t i = 0; i < kept.size(); i += 3) {
+                uint32_t a = kept[i], b = kept[i + 1], c = kept[i + 2];
+                glm::vec3 before = glm::cross(clustered[b] - clustered[a], clustered[c] - clustered[a]);
+                glm::vec3 after = glm::cross(occluder.positions[b] - occluder.positions[a], occluder.positions[c] - occluder.positions[a]);
+                if (glm::dot(before, after) <= 0.0f)
+                    continue;
+                occluder.indices.insert(occluder.indices.end(), {a, b, c});
+            }
+            return occluder;
+        }
+    };
+
+    // one occluder placed in the world for a frame
+    struct OccluderInstance {
+        const Occluder* occluder;
+        glm::mat4 model;
+    };
+
+    // Software occlusion culling on the CPU, no GPU readback. Occluders are rasterized into a small depth
+    // buffer split into bands of tile rows, each band a job on the job system that only writes its own
+    // rows, so no locking. Rows are filled eight pixels per instruction on CPUs with AVX2: the edge
+    // functions give a coverage mask and only covered pixels take the nearer depth (scalar per pixel
+    // elsewhere). Every 8x8 tile then keeps the farthest depth of its pixels, the hierarchy boxes are tested
+    // against before looking at single pixels.
+    //
+    // Depth is window depth in [0, 1], cleared to 1 (far). Occluder triangles reaching past the near
+    // plane are skipped rather than clipped, which only loses occlusion; they would otherwise land in
+    // front of it, where the GPU never draws anything.
+    class OcclusionBuffer {
+    public:
+        static const unsigned int TILE_SIZE = 8;
+
+        // width is rounded up to a multiple of 8 pixels and height to whole tiles
+        OcclusionBuffer(unsigned int width = 320, unsigned int height = 192)
+            : width(round_up(std::max(width, 1u))), height(round_up(std::max(height, 1u))),
+              tiles_x(this->width / TILE_SIZE), tiles_y(this->height / TILE_SIZE),
+              depth(this->width * this->height, 1.0f), tile_depth(tiles_x * tiles_y, 1.0f) {}
+
+        // clears the buffer and rasterizes the occluders as seen through view_projection
+        void render(std::span<const OccluderInstance> occluders, const glm::mat4& view_projection, JobSystem& jobs) {
+            this->view_projection = view_projection;
+
+            // setup: every occluder writes its triangles to its own range, culled ones are marked empty
+            std::vector<size_t> offsets(occluders.size() + 1, 0);
+            for (size_t i = 0; i < occluders.size(); i++)
+                offsets[i + 1] = offsets[i] + occluders[i].occluder->indices.size() / 3;
+            triangles.resize(offsets.back());
+            jobs.parallel_for(occluders.size(), 8, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    setup(occluders[i], triangles.data() + offsets[i]);
+            });
+
+            rasterized = 0;
+            for (const Triangle& triangle : triangles)
+                rasterized += triangle.min_y <= triangle.max_y;
+
+            // one band of tile rows per job, every band walks all triangles but only fills its own rows
+            jobs.parallel_for(tiles_y, 1, [&](size_t begin, size_t end) {
+                for (size_t band = begin; band < end; band++)
+                    raster_band(static_cast<unsigned int>(band));
+            });
+        }
+
+        // whether any part of the world space box may be visible, i.e. is not behind the occluders
+        bool visible(const glm::vec3& min, const glm::vec3& max) const {
+            // screen rectangle and nearest depth of the box's corners
+            glm::vec2 low(1e30f), high(-1e30f);
+            float nearest = 1.0f;
+            for (int i = 0; i < 8; i++) {
+                glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+                glm::vec4 clip = view_projection * glm::vec4(corner, 1.0f);
+                // reaches past the near plane, its rectangle is unbounded
+                if (!in_front(clip))
+                    return true;
+                glm::vec3 window = to_window(clip);
+                low = glm::min(low, glm::vec2(window));
+                high = glm::max(high, glm::vec2(window));
+                nearest = std::min(nearest, window.z);
+            }
+
+            // pixel centers inside the rectangle; a box between pixel centers is too small to decide on
+            int x0, x1, y0, y1;
+            pixel_range(low.x, high.x, width, x0, x1);
+            pixel_range(low.y, high.y, height, y0, y1);
+            if (x0 > x1 || y0 > y1)
+                return true;
+
+            for (int ty = y0 / int(TILE_SIZE); ty <= y1 / int(TILE_SIZE); ty++) {
+                for (int tx = x0 / int(TILE_SIZE); tx <= x1 / int(TILE_SIZE); tx++) {
+                    if (nearest > tile_depth[ty * tiles_x + tx])
+                        continue;
+                    // the tile has something farther than the box somewhere, look at the pixels the box covers
+                    int px0 = std::max(x0, tx * int(TILE_SIZE)), px1 = std::min(x1, tx * int(TILE_SIZE) + int(TILE_SIZE) - 1);
+                    int py0 = std::max(y0, ty * int(TILE_SIZE)), py1 = std::min(y1, ty * int(TILE_SIZE) + int(TILE_SIZE) - 1);
+                    for (int y = py0; y <= py1; y++) {
+                        for (int x = px0; x <= px1; x++) {
+                            if (nearest <= depth[y * width + x])
+                                return true;
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+        // occluder triangles that were front facing and in front of the camera in the last render()
+        size_t triangles_rasterized() const { return rasterized; }
+
+    private:
+        // in front of the near plane (OpenGL clip space, -w <= z); also false for anything behind the camera
+        static bool in_front(const glm::vec4& clip) {
+            return clip.z >= -clip.w;
+        }
+
+        // edge functions and depth plane of a screen space triangle, each as a * x + b * y + c at pixel
+        // centers; an empty bounding box (min_y > max_y) marks a culled triangle
+        struct Triangle {
+            float edge[3][3];
+            float z[3];
+            int min_x, max_x, min_y, max_y;
+        };
+
+        unsigned int width, height;
+        unsigned int tiles_x, tiles_y;
+        std::vector<float> depth;
+        std::vector<float> tile_depth;
+        std::vector<Triangle> triangles;
+        glm::mat4 view_projection{1.0f};
+        size_t rasterized = 0;
+
+        static unsigned int round_up(unsigned int size) {
+            return (size + TILE_SIZE - 1) / TILE_SIZE * TILE_SIZE;
+        }
+
+        // first and last pixel whose center lies in [low, high] along an axis of size pixels, clamped to
+        // the buffer before converting so far off screen coordinates cannot overflow
+        static void pixel_range(float low, float high, unsigned int size, int& first, int& last) {
+            first = static_cast<int>(std::ceil(std::clamp(low - 0.5f, 0.0f, float(size))));
+            last = static_cast<int>(std::floor(std::clamp(high - 0.5f, -1.0f, float(size) - 1.0f)));
+        }
+
+        // pixel coordinates (origin at the bottom left corner) and window depth
+        glm::vec3 to_window(const glm::vec4& clip) const {
+            glm::vec3 ndc = glm::vec3(clip) / clip.w;
+            return glm::vec3((ndc.x * 0.5f + 0.5f) * float(width), (ndc.y * 0.5f + 0.5f) * float(height), ndc.z * 0.5f + 0.5f);
+        }
+
+        void setup(const OccluderInstance& instance, Triangle* out) const {
+            const Occluder& occluder = *instance.occluder;
+            glm::mat4 transform = view_projection * instance.model;
+            for (size_t t = 0; t + 2 < occluder.indices.size(); t += 3) {
+                Triangle& triangle = out[t / 3];
+                triangle.min_y = 1;
+                triangle.max_y = 0;
+
+                glm::vec3 v[3];
+                bool behind = false;
+                for (int i = 0; i < 3; i++) {
+                    glm::vec4 clip = transform * glm::vec4(occluder.positions[occluder.indices[t + i]], 1.0f);
+                    behind |= !in_front(clip);
+                    v[i] = behind ? glm::vec3(0.0f) : to_window(clip);
+                }
+                // twice the signed area, counter clockwise (front facing) is positive
+                float area = (v[1].x - v[0].x) * (v[2].y - v[0].y) - (v[2].x - v[0].x) * (v[1].y - v[0].y);
+                if (behind || area <= 0.0f)
+                    continue;
+
+                float min_x = std::min({v[0].x, v[1].x, v[2].x}), max_x = std::max({v[0].x, v[1].x, v[2].x});
+                float min_y = std::min({v[0].y, v[1].y, v[2].y}), max_y = std::max({v[0].y, v[1].y, v[2].y});
+                pixel_range(min_x, max_x, width, triangle.min_x, triangle.max_x);
+                pixel_range(min_y, max_y, height, triangle.min_y, triangle.max_y);
+                if (triangle.min_x > triangle.max_x) {
+                    triangle.min_y = 1;
+                    triangle.max_y = 0;
+                    continue;
+                }
+
+                // edge i runs from v[i] to v[i + 1], positive on the inside
+                for (int i = 0; i < 3; i++) {
+                    const glm::vec3& from = v[i];
+                    const glm::vec3& to = v[(i + 1) % 3];
+                    float a = from.y - to.y;
+                    float b = to.x - from.x;
+                    triangle.edge[i][0] = a;
+                    triangle.edge[i][1] = b;
+                    triangle.edge[i][2] = -(a * from.x + b * from.y);
+                }
+                float dzdx = ((v[1].z - v[0].z) * (v[2].y - v[0].y) - (v[2].z - v[0].z) * (v[1].y - v[0].y)) / area;
+                float dzdy = ((v[2].z - v[0].z) * (v[1].x - v[0].x) - (v[1].z - v[0].z) * (v[2].x - v[0].x)) / area;
+                triangle.z[0] = dzdx;
+                triangle.z[1] = dzdy;
+                triangle.z[2] = v[0].z - dzdx * v[0].x - dzdy * v[0].y;
+            }
+        }
+
+        void raster_band(unsigned int band) {
+            int band_min = static_cast<int>(band * TILE_SIZE);
+            int band_max = band_min + static_cast<int>(TILE_SIZE) - 1;
+            for (int y = band_min; y <= band_max; y++)
+                std::fill_n(depth.begin() + y * width, width, 1.0f);
+
+            for (const Triangle& triangle : triangles) {
+                int y0 = std::max(triangle.min_y, band_min);
+                int y1 = std::min(triangle.max_y, band_max);
+                for (int y = y0; y <= y1; y++)
+                    raster_row(triangle, y);
+            }
+
+            for (unsigned int tx = 0; tx < tiles_x; tx++) {
+                float farthest = 0.0f;
+                for (int y = band_min; y <= band_max; y++) {
+                    const float* row = depth.data() + y * width + tx * TILE_SIZE;
+                    farthest = std::max(farthest, *std::max_element(row, row + TILE_SIZE));
+                }
+                tile_depth[band * tiles_x + tx] = farthest;
+            }
+        }
+
+        void raster_row(const Triangle& triangle, int y) {
+            float py = float(y) + 0.5f;
+            float* row = depth.data() + y * width;
+            float row_edge[3];
+            for (int i = 0; i < 3; i++)
+                row_edge[i] = triangle.edge[i][1] * py + triangle.edge[i][2];
+            float row_z = triangle.z[1] * py + triangle.z[2];
+
+#ifdef BITFORGE_X86
+            if (cpu_has_avx2()) {
+                raster_row_avx2(triangle, row, row_edge, row_z);
+                return;
+            }
+#endif
+            for (int x = triangle.min_x; x <= triangle.max_x; x++) {
+                float px = float(x) + 0.5f;
+                if (triangle.edge[0][0] * px + row_edge[0] < 0.0f || triangle.edge[1][0] * px + row_edge[1] < 0.0f || triangle.edge[2][0] * px + row_edge[2] < 0.0f)
+                    continue;
+                row[x] = std::min(row[x], triangle.z[0] * px + row_z);
+            }
+        }
+
+#ifdef BITFORGE_X86
+        // whole groups of eight from the aligned group holding min_x, width is a multiple of eight
+        BITFORGE_TARGET_AVX2 static void raster_row_avx2(const Triangle& triangle, float* row, const float row_edge[3], float row_z) {
+            int x = triangle.min_x & ~7;
+            const __m256 lanes = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+            const __m256 zero = _mm256_setzero_ps();
+            for (; x <= triangle.max_x; x += 8) {
+                __m256 px = _mm256_add_ps(_mm256_set1_ps(float(x)), lanes);
+                __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+                for (int i = 0; i < 3; i++) {
+                    __m256 edge = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.edge[i][0]), px), _mm256_set1_ps(row_edge[i]));
+                    inside = _mm256_and_ps(inside, _mm256_cmp_ps(edge, zero, _CMP_GE_OQ));
+                }
+                if (_mm256_testz_ps(inside, inside))
+                    continue;
+                __m256 z = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.z[0]), px), _mm256_set1_ps(row_z));
+                __m256 old = _mm256_loadu_ps(row + x);
+                _mm256_storeu_ps(row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, z), inside));
+            }
+        }
+#endif
+    };
+}
+
+#endif
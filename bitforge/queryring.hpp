@@ -0,0 +1,88 @@
+#ifndef QUERYRING_H
+#define QUERYRING_H
+
+#include <glad/glad.h>
+
+#include <glresource.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace BitForge {
+    // GPU queries of one target (GL_TIME_ELAPSED, GL_SAMPLES_PASSED, ...) for several frames in flight,
+    // per_frame of them per frame, read back without stalling: a frame's results are collected when its
+    // queries come up for reuse, frames - 1 frames later, and only if the GPU already has them.
+    // Only used on the thread owning the GL context.
+    class QueryRing {
+    public:
+        QueryRing(GLenum target, unsigned int per_frame, unsigned int frames = 3)
+            : target(target), per_frame(std::max(per_frame, 1u)), frames(std::max(frames, 2u)),
+              begun(this->per_frame * this->frames, 0), values(this->per_frame, 0) {
+            for (unsigned int i = 0; i < this->per_frame * this->frames; i++)
+                queries.push_back(create_query(target));
+        }
+
+        // starts query index of the current frame; one query of the target can be active at a time
+        void begin(unsigned int index) {
+            unsigned int slot = frame * per_frame + index;
+            glBeginQuery(target, queries[slot].get());
+            begun[slot] = 1;
+        }
+
+        void end() {
+            glEndQuery(target);
+        }
+
+        // closes the current frame and moves on to the oldest one, collecting its results; whether
+        // results() changed
+        bool end_frame() {
+            frame = (frame + 1) % frames;
+            return collect();
+        }
+
+        // whether results() holds a frame yet
+        bool ready() const { return collected; }
+
+        // one value per query of the newest collected frame, 0 for queries that frame did not run
+        const std::vector<GLuint64>& results() const { return values; }
+
+    private:
+        GLenum target;
+        unsigned int per_frame;
+        unsigned int frames;
+        unsigned int frame = 0;
+        std::vector<QueryHandle> queries;
+        std::vector<uint8_t> begun;
+        std::vector<GLuint64> values;
+        bool collected = false;
+
+        bool collect() {
+            unsigned int first = frame * per_frame;
+            bool any = false;
+            for (unsigned int i = 0; i < per_frame; i++) {
+                if (!begun[first + i])
+                    continue;
+                any = true;
+                GLint available = GL_FALSE;
+                glGetQueryObjectiv(queries[first + i].get(), GL_QUERY_RESULT_AVAILABLE, &available);
+                // a frame still in flight is skipped rather than waited for
+                if (!available)
+                    return false;
+            }
+            if (!any)
+                return false;
+
+            for (unsigned int i = 0; i < per_frame; i++) {
+                values[i] = 0;
+                if (begun[first + i])
+                    glGetQueryObjectui64v(queries[first + i].get(), GL_QUERY_RESULT, &values[i]);
+                begun[first + i] = 0;
+            }
+            collected = true;
+            return true;
+        }
+    };
+}
+
+#endif
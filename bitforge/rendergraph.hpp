@@ -0,0 +1,535 @@
+#ifndef RENDERGRAPH_H
+#define RENDERGRAPH_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <glresource.hpp>
+#include <glstate.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+namespace BitForge {
+    // size and format of a texture the graph allocates; filter is how passes sample it, depth formats
+    // are always sampled with GL_NEAREST
+    struct TextureDesc {
+        GLenum format;
+        unsigned int width, height;
+        GLenum filter = GL_LINEAR;
+
+        bool operator==(const TextureDesc&) const = default;
+    };
+
+    // what happens to an attachment's contents when a pass binds it
+    enum class Load : uint8_t {
+        LOAD,     // keeps what earlier passes left, so the pass also reads the attachment
+        CLEAR,    // clears to the attachment's clear value
+        DONT_CARE // the pass overwrites every texel, the old contents are invalidated
+    };
+
+    using ResourceId = uint32_t;
+    const ResourceId NO_RESOURCE = ~0u;
+
+    class RenderGraph;
+
+    // Declares what one pass reads and writes, returned by RenderGraph::add_pass. Color attachments take
+    // the draw buffers in the order they are declared.
+    class PassBuilder {
+    public:
+        PassBuilder(RenderGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+        void color(ResourceId texture, Load load, glm::vec4 clear = glm::vec4(0.0f));
+        // write false only tests against the depth, e.g. for blended passes
+        void depth(ResourceId texture, Load load, float clear = 1.0f, bool write = true);
+        // read through a sampler
+        void sample(ResourceId texture);
+        // read or written as an image by a compute shader
+        void read_image(ResourceId texture);
+        void write_image(ResourceId texture);
+        // the pass does something outside the graph (e.g. draws to the window) and is never culled
+        void side_effects();
+        // draws to the bottom left width x height of its attachments instead of all of them, e.g. for
+        // dynamic resolution
+        void render_area(unsigned int width, unsigned int height);
+
+    private:
+        RenderGraph& graph;
+        uint32_t pass;
+    };
+
+    // A frame's passes declared with the textures they touch, rebuilt every frame in the order the passes
+    // run. compile() then works out:
+    // - which passes contribute to an output or have side effects; the others are culled
+    // - when transient textures live, from the first to the last pass using them, and which of them can
+    //   share a texture because their lifetimes do not overlap; textures are pooled across frames, so a
+    //   frame of the same shape allocates nothing
+    // - the memory barriers compute shader writes need before later passes read them
+    // execute() runs the passes that were kept, binding a framebuffer with each pass's attachments,
+    // clearing or invalidating them as they are loaded and invalidating every transient texture after
+    // its last use, so tiled GPUs never write back what nobody reads.
+    //
+    // Transient contents are undefined until a pass writes them with CLEAR or DONT_CARE. Passes are
+    // plain functions over the graph, which only has to outlive execute(); like all GL code the graph
+    // must only be used on the thread owning the context.
+    class RenderGraph {
+    public:
+        static const unsigned int MAX_COLOR_ATTACHMENTS = 8;
+        // pooled textures no frame asked for in this many frames are deleted, e.g. after a resize
+        static const unsigned int FRAMES_KEPT = 3;
+
+        // starts declaring a new frame
+        void reset() {
+            resources.clear();
+            passes.clear();
+            uses.clear();
+        }
+
+        // a texture only this frame uses, allocated by compile()
+        ResourceId create_texture(const char* name, const TextureDesc& desc) {
+            resources.push_back({name, desc, 0, false});
+            return static_cast<ResourceId>(resources.size() - 1);
+        }
+
+        // a texture owned outside the graph, it is never aliased or invalidated
+        ResourceId import_texture(const char* name, GLuint texture, const TextureDesc& desc) {
+            resources.push_back({name, desc, texture, true});
+            return static_cast<ResourceId>(resources.size() - 1);
+        }
+
+        // a texture whose contents are needed after the frame, the passes writing it are kept
+        void mark_output(ResourceId texture) {
+            resources[texture].output = true;
+        }
+
+        // adds a pass running execute(graph); execute is referenced, not copied, and has to live until
+        // execute() returns
+        template <typename F>
+        PassBuilder add_pass(const char* name, F& execute) {
+            Pass pass;
+            pass.name = name;
+            pass.data = &execute;
+            pass.function = [](void* data, const RenderGraph& graph) { (*static_cast<F*>(data))(graph); };
+            passes.push_back(pass);
+            return PassBuilder(*this, static_cast<uint32_t>(passes.size() - 1));
+        }
+
+        void compile() {
+            cull();
+            allocate();
+            plan_barriers();
+        }
+
+        void execute() {
+            GLState& state = gl_state();
+            if (framebuffers.size() < passes.size())
+                framebuffers.resize(passes.size());
+
+            for (uint32_t p = 0; p < passes.size(); p++) {
+                const Pass& pass = passes[p];
+                if (pass.culled)
+                    continue;
+                if (pass.barriers != 0)
+                    glMemoryBarrier(pass.barriers);
+                if (pass.color_count > 0 || pass.depth.texture != NO_RESOURCE)
+                    begin_attachments(p, state);
+
+                pass.function(pass.data, *this);
+
+                // nothing reads these again this frame
+                for (uint32_t u = pass.first_use; u < pass.first_use + pass.use_count; u++) {
+                    Resource& resource = resources[uses[u].resource];
+                    if (!resource.imported && !resource.output && resource.last_use == p && resource.framebuffer != 0) {
+                        glInvalidateNamedFramebufferData(resource.framebuffer, 1, &resource.attachment);
+                        resource.framebuffer = 0;
+                    }
+                }
+            }
+        }
+
+        // the GL name of a texture, valid from compile() to the end of the frame
+        GLuint texture(ResourceId texture) const {
+            return resources[texture].texture;
+        }
+
+        const TextureDesc& desc(ResourceId texture) const {
+            return resources[texture].desc;
+        }
+
+        bool culled(uint32_t pass) const {
+            return passes[pass].culled;
+        }
+
+        // video memory held by pooled textures, whether this frame used them or not
+        size_t allocated_bytes() const {
+            size_t bytes = 0;
+            for (const PooledTexture& pooled : pool)
+                bytes += static_cast<size_t>(pooled.desc.width) * pooled.desc.height * texel_bytes(pooled.desc.format);
+            return bytes;
+        }
+
+    private:
+        friend class PassBuilder;
+
+        enum Access : uint8_t {
+            SAMPLED = 1,
+            IMAGE_READ = 2,
+            IMAGE_WRITE = 4,
+            ATTACHMENT_READ = 8,
+            ATTACHMENT_WRITE = 16,
+            READS = SAMPLED | IMAGE_READ | ATTACHMENT_READ,
+            WRITES = IMAGE_WRITE | ATTACHMENT_WRITE
+        };
+
+        struct Resource {
+            const char* name;
+            TextureDesc desc;
+            GLuint texture;
+            bool imported;
+            bool output = false;
+            // set by compile()
+            bool needed = false;
+            bool image_written = false; // by a compute shader since the last barrier covering it
+            GLbitfield barriers_done = 0;
+            uint32_t first_use = 0, last_use = 0;
+            size_t pooled = 0;
+            // the framebuffer it was last attached to, to invalidate it through after its last use
+            GLuint framebuffer = 0;
+            GLenum attachment = 0;
+        };
+
+        struct Use {
+            ResourceId resource;
+            uint8_t access;
+        };
+
+        struct Attachment {
+            ResourceId texture = NO_RESOURCE;
+            Load load = Load::LOAD;
+            glm::vec4 clear = glm::vec4(0.0f);
+        };
+
+        struct Pass {
+            const char* name = nullptr;
+            void (*function)(void* data, const RenderGraph& graph) = nullptr;
+            void* data = nullptr;
+            Attachment colors[MAX_COLOR_ATTACHMENTS];
+            unsigned int color_count = 0;
+            Attachment depth;
+            bool side_effects = false;
+            unsigned int area_width = 0, area_height = 0; // 0 for the size of the attachments
+            // the pass's slice of uses, passes declare theirs one after another
+            uint32_t first_use = 0, use_count = 0;
+            // set by compile()
+            bool culled = false;
+            GLbitfield barriers = 0;
+        };
+
+        struct PooledTexture {
+            TextureDesc desc;
+            TextureHandle texture;
+            bool taken = false;
+            bool image_written = false;
+            unsigned int idle_frames = 0;
+        };
+
+        // framebuffer of a pass, re-attached only when the pass's textures change
+        struct PassFramebuffer {
+            FramebufferHandle framebuffer;
+            GLuint colors[MAX_COLOR_ATTACHMENTS] = {};
+            unsigned int color_count = 0;
+            GLuint depth = 0;
+        };
+
+        std::vector<Resource> resources;
+        std::vector<Pass> passes;
+        std::vector<Use> uses;
+        std::vector<PooledTexture> pool;
+        std::vector<PassFramebuffer> framebuffers;
+
+        void use(uint32_t pass, ResourceId resource, uint8_t access) {
+            // passes declare one after another, so a pass's uses stay contiguous
+            Pass& declaring = passes[pass];
+            if (declaring.use_count == 0)
+                declaring.first_use = static_cast<uint32_t>(uses.size());
+            uses.push_back({resource, access});
+            declaring.use_count++;
+        }
+
+        // from the last pass back: a pass is kept if it has side effects or writes something a kept pass
+        // after it reads; a write that doesn't also read ends what earlier passes wrote
+        void cull() {
+            for (Resource& resource : resources)
+                resource.needed = resource.output;
+            for (uint32_t p = static_cast<uint32_t>(passes.size()); p-- > 0;) {
+                Pass& pass = passes[p];
+                bool kept = pass.side_effects;
+                for (uint32_t u = pass.first_use; u < pass.first_use + pass.use_count && !kept; u++)
+                    kept = (uses[u].access & WRITES) && resources[uses[u].resource].needed;
+                pass.culled = !kept;
+                if (!kept)
+                    continue;
+                for (uint32_t u = pass.first_use; u < pass.first_use + pass.use_count; u++) {
+                    if ((uses[u].access & WRITES) && !(uses[u].access & READS))
+                        resources[uses[u].resource].needed = false;
+                }
+                for (uint32_t u = pass.first_use; u < pass.first_use + pass.use_count; u++) {
+                    if (uses[u].access & READS)
+                        resources[uses[u].resource].needed = true;
+                }
+            }
+        }
+
+        // Lifetimes over the kept passes, then a pooled texture per transient: a texture is free again
+        // after the last pass using its current resource, so resources living in disjoint pass ranges
+        // of the same size and format share it.
+        void allocate() {
+            const uint32_t UNUSED = ~0u;
+            for (Resource& resource : resources) {
+                resource.first_use = UNUSED;
+                resource.framebuffer = 0;
+            }
+            for (uint32_t p = 0; p < passes.size(); p++) {
+                if (passes[p].culled)
+                    continue;
+                for (uint32_t u = passes[p].first_use; u < passes[p].first_use + passes[p].use_count; u++) {
+                    Resource& resource = resources[uses[u].resource];
+                    if (resource.first_use == UNUSED)
+                        resource.first_use = p;
+                    resource.last_use = p;
+                }
+            }
+
+            // resources index the pool, so idle textures go before any is handed out
+            for (PooledTexture& pooled : pool) {
+                pooled.taken = false;
+                pooled.idle_frames++;
+            }
+            std::erase_if(pool, [](const PooledTexture& pooled) { return pooled.idle_frames > FRAMES_KEPT; });
+            for (uint32_t p = 0; p < passes.size(); p++) {
+                if (passes[p].culled)
+                    continue;
+                for (uint32_t u = passes[p].first_use; u < passes[p].first_use + passes[p].use_count; u++) {
+                    Resource& resource = resources[uses[u].resource];
+                    if (!resource.imported && resource.first_use == p && resource.texture == 0)
+                        acquire(resource);
+                }
+                for (uint32_t u = passes[p].first_use; u < passes[p].first_use + passes[p].use_count; u++) {
+                    Resource& resource = resources[uses[u].resource];
+                    if (!resource.imported && resource.last_use == p && resource.texture != 0 && pool[resource.pooled].taken)
+                        pool[resource.pooled].taken = false;
+                }
+            }
+        }
+
+        void acquire(Resource& resource) {
+            size_t index = pool.size();
+            for (size_t i = 0; i < pool.size(); i++) {
+                if (!pool[i].taken && pool[i].desc == resource.desc) {
+                    index = i;
+                    break;
+                }
+            }
+            if (index == pool.size())
+                pool.push_back({resource.desc, create_target(resource.desc)});
+            PooledTexture& pooled = pool[index];
+            pooled.taken = true;
+            pooled.idle_frames = 0;
+            resource.pooled = index;
+            resource.texture = pooled.texture.get();
+            // a compute shader writing the previous occupant still has to be waited for
+            resource.image_written = std::exchange(pooled.image_written, false);
+        }
+
+        // compute shader writes reach later reads only through glMemoryBarrier, with the bit matching
+        // how they read; attachment writes and sampled reads are ordered by GL itself
+        void plan_barriers() {
+            for (Resource& resource : resources) {
+                if (resource.imported)
+                    resource.image_written = false;
+                resource.barriers_done = 0;
+            }
+            for (uint32_t p = 0; p < passes.size(); p++) {
+                Pass& pass = passes[p];
+                pass.barriers = 0;
+                if (pass.culled)
+                    continue;
+                for (uint32_t u = pass.first_use; u < pass.first_use + pass.use_count; u++) {
+                    Resource& resource = resources[uses[u].resource];
+                    if (!resource.image_written)
+                        continue;
+                    GLbitfield needed = 0;
+                    if (uses[u].access & SAMPLED)
+                        needed |= GL_TEXTURE_FETCH_BARRIER_BIT;
+                    if (uses[u].access & (IMAGE_READ | IMAGE_WRITE))
+                        needed |= GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+                    if (uses[u].access & (ATTACHMENT_READ | ATTACHMENT_WRITE))
+                        needed |= GL_FRAMEBUFFER_BARRIER_BIT;
+                    pass.barriers |= needed & ~resource.barriers_done;
+                    resource.barriers_done |= needed;
+                }
+                for (uint32_t u = pass.first_use; u < pass.first_use + pass.use_count; u++) {
+                    Resource& resource = resources[uses[u].resource];
+                    if (uses[u].access & IMAGE_WRITE) {
+                        resource.image_written = true;
+                        resource.barriers_done = 0;
+                    }
+                }
+            }
+            // the next frame's occupant of a pooled texture inherits unfinished writes
+            for (const Resource& resource : resources) {
+                if (!resource.imported && resource.texture != 0)
+                    pool[resource.pooled].image_written = resource.image_written;
+            }
+        }
+
+        void begin_attachments(uint32_t p, GLState& state) {
+            const Pass& pass = passes[p];
+            PassFramebuffer& target = framebuffers[p];
+            if (!target.framebuffer)
+                target.framebuffer = create_framebuffer();
+            GLuint framebuffer = target.framebuffer.get();
+
+            // attach what changed since this pass last ran
+            bool changed = false;
+            GLenum draw_buffers[MAX_COLOR_ATTACHMENTS];
+            for (unsigned int i = 0; i < std::max(pass.color_count, target.color_count); i++) {
+                GLuint texture = i < pass.color_count ? resources[pass.colors[i].texture].texture : 0;
+                if (target.colors[i] != texture) {
+                    glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0 + i, texture, 0);
+                    target.colors[i] = texture;
+                    changed = true;
+                }
+                draw_buffers[i] = GL_COLOR_ATTACHMENT0 + i;
+            }
+            if (target.color_count != pass.color_count) {
+                if (pass.color_count > 0)
+                    glNamedFramebufferDrawBuffers(framebuffer, static_cast<GLsizei>(pass.color_count), draw_buffers);
+                else
+                    glNamedFramebufferDrawBuffer(framebuffer, GL_NONE);
+                target.color_count = pass.color_count;
+                changed = true;
+            }
+            GLuint depth = pass.depth.texture != NO_RESOURCE ? resources[pass.depth.texture].texture : 0;
+            GLenum depth_point = pass.depth.texture != NO_RESOURCE && has_stencil(resources[pass.depth.texture].desc.format) ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT;
+            if (target.depth != depth) {
+                // detaching either point detaches a texture attached to both
+                glNamedFramebufferTexture(framebuffer, GL_DEPTH_STENCIL_ATTACHMENT, 0, 0);
+                if (depth != 0)
+                    glNamedFramebufferTexture(framebuffer, depth_point, depth, 0);
+                target.depth = depth;
+                changed = true;
+            }
+            // only checked when the pool hands the pass different textures, not every frame
+            if (changed && glCheckNamedFramebufferStatus(framebuffer, GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "ERROR::FRAMEBUFFER:: Framebuffer of pass " << pass.name << " is not complete!" << std::endl;
+
+            state.bindFramebuffer(framebuffer);
+            const TextureDesc& size = resources[pass.color_count > 0 ? pass.colors[0].texture : pass.depth.texture].desc;
+            glViewport(0, 0, static_cast<GLsizei>(pass.area_width ? pass.area_width : size.width), static_cast<GLsizei>(pass.area_height ? pass.area_height : size.height));
+
+            // passes leave color writes on; clears respect the depth mask, so it is turned on for them
+            for (unsigned int i = 0; i < pass.color_count; i++) {
+                const Attachment& attachment = pass.colors[i];
+                load(framebuffer, attachment, GL_COLOR_ATTACHMENT0 + i, [&] {
+                    glClearNamedFramebufferfv(framebuffer, GL_COLOR, static_cast<GLint>(i), &attachment.clear[0]);
+                });
+            }
+            if (depth != 0) {
+                load(framebuffer, pass.depth, depth_point, [&] {
+                    glDepthMask(GL_TRUE);
+                    if (depth_point == GL_DEPTH_STENCIL_ATTACHMENT)
+                        glClearNamedFramebufferfi(framebuffer, GL_DEPTH_STENCIL, 0, pass.depth.clear.x, 0);
+                    else
+                        glClearNamedFramebufferfv(framebuffer, GL_DEPTH, 0, &pass.depth.clear.x);
+                });
+            }
+        }
+
+        template <typename Clear>
+        void load(GLuint framebuffer, const Attachment& attachment, GLenum point, Clear&& clear) {
+            Resource& resource = resources[attachment.texture];
+            resource.framebuffer = framebuffer;
+            resource.attachment = point;
+            if (attachment.load == Load::CLEAR)
+                clear();
+            else if (attachment.load == Load::DONT_CARE)
+                glInvalidateNamedFramebufferData(framebuffer, 1, &point);
+        }
+
+        static TextureHandle create_target(const TextureDesc& desc) {
+            TextureHandle texture = create_texture_2d(desc.format, static_cast<GLsizei>(desc.width), static_cast<GLsizei>(desc.height));
+            GLenum filter = is_depth(desc.format) ? GL_NEAREST : desc.filter;
+            glTextureParameteri(texture.get(), GL_TEXTURE_MIN_FILTER, filter);
+            glTextureParameteri(texture.get(), GL_TEXTURE_MAG_FILTER, filter);
+            glTextureParameteri(texture.get(), GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(texture.get(), GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            // samplers read the depth of depth and stencil textures
+            if (has_stencil(desc.format))
+                glTextureParameteri(texture.get(), GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
+            return texture;
+        }
+
+        static bool has_stencil(GLenum format) {
+            return format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+        }
+
+        static bool is_depth(GLenum format) {
+            return has_stencil(format) || format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F;
+        }
+
+        // what drivers typically store, three channel formats are padded to four
+        static size_t texel_bytes(GLenum format) {
+            switch (format) {
+                case GL_R8: return 1;
+                case GL_RG8: case GL_R16F: case GL_DEPTH_COMPONENT16: return 2;
+                case GL_RGBA16F: case GL_RGB16F: case GL_RG32F: case GL_DEPTH32F_STENCIL8: return 8;
+                case GL_RGBA32F: case GL_RGB32F: return 16;
+                default: return 4;
+            }
+        }
+    };
+
+    inline void PassBuilder::color(ResourceId texture, Load load, glm::vec4 clear) {
+        RenderGraph::Pass& declaring = graph.passes[pass];
+        declaring.colors[declaring.color_count++] = {texture, load, clear};
+        graph.use(pass, texture, RenderGraph::ATTACHMENT_WRITE | (load == Load::LOAD ? RenderGraph::ATTACHMENT_READ : 0));
+    }
+
+    inline void PassBuilder::depth(ResourceId texture, Load load, float clear, bool write) {
+        RenderGraph::Pass& declaring = graph.passes[pass];
+        declaring.depth = {texture, load, glm::vec4(clear)};
+        // the depth test reads what is loaded
+        uint8_t access = load == Load::LOAD ? RenderGraph::ATTACHMENT_READ : 0;
+        if (write || load != Load::LOAD)
+            access |= RenderGraph::ATTACHMENT_WRITE;
+        graph.use(pass, texture, access);
+    }
+
+    inline void PassBuilder::sample(ResourceId texture) {
+        graph.use(pass, texture, RenderGraph::SAMPLED);
+    }
+
+    inline void PassBuilder::read_image(ResourceId texture) {
+        graph.use(pass, texture, RenderGraph::IMAGE_READ);
+    }
+
+    inline void PassBuilder::write_image(ResourceId texture) {
+        graph.use(pass, texture, RenderGraph::IMAGE_WRITE);
+    }
+
+    inline void PassBuilder::side_effects() {
+        graph.passes[pass].side_effects = true;
+    }
+
+    inline void PassBuilder::render_area(unsigned int width, unsigned int height) {
+        graph.passes[pass].area_width = width;
+        graph.passes[pass].area_height = height;
+    }
+}
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace BitForge {
+    // passes run in this order, the pass is the most significant field of a sort key
+    enum RenderPass : uint32_t {
+        PASS_OPAQUE = 0,
+        PASS_ALPHA_TESTED = 1, // opaque but discarding cut out texels, drawn after the opaque pass
+        PASS_TRANSPARENT = 2
+    };
+
+    // A sort key packs everything that decides the submission order of a draw into 64 bits, from most to
+    // least significant: pass (4), program (8), material (16), mesh (16), depth (20). Sorting the keys
+    // groups draws that share a program, then a material, then a mesh, so the executor only changes
+    // state at group boundaries; depth orders the draws inside a group.
+    namespace SortKey {
+        const unsigned int PASS_BITS = 4, PROGRAM_BITS = 8, MATERIAL_BITS = 16, MESH_BITS = 16, DEPTH_BITS = 20;
+        const unsigned int DEPTH_SHIFT = 0;
+        const unsigned int MESH_SHIFT = DEPTH_SHIFT + DEPTH_BITS;
+        const unsigned int MATERIAL_SHIFT = MESH_SHIFT + MESH_BITS;
+        const unsigned int PROGRAM_SHIFT = MATERIAL_SHIFT + MATERIAL_BITS;
+        const unsigned int PASS_SHIFT = PROGRAM_SHIFT + PROGRAM_BITS;
+        static_assert(PASS_SHIFT + PASS_BITS == 64);
+
+        constexpr uint64_t field(uint64_t value, unsigned int bits, unsigned int shift) {
+            return (value & ((uint64_t(1) << bits) - 1)) << shift;
+        }
+
+        constexpr uint64_t make(uint32_t pass, uint32_t program, uint32_t material, uint32_t mesh, uint32_t depth) {
+            return field(pass, PASS_BITS, PASS_SHIFT) | field(program, PROGRAM_BITS, PROGRAM_SHIFT) | field(material, MATERIAL_BITS, MATERIAL_SHIFT)
+                 | field(mesh, MESH_BITS, MESH_SHIFT) | field(depth, DEPTH_BITS, DEPTH_SHIFT);
+        }
+
+        // everything but the depth: packets with equal state can be drawn by one instanced call
+        constexpr uint64_t state(uint64_t key) {
+            return key >> MESH_SHIFT;
+        }
+
+        // pass, program and material: meshes sharing them can be drawn by one multi-draw
+        constexpr uint64_t batch(uint64_t key) {
+            return key >> MATERIAL_SHIFT;
+        }
+
+        constexpr uint32_t pass(uint64_t key) {
+            return static_cast<uint32_t>(key >> PASS_SHIFT);
+        }
+
+        constexpr uint32_t program(uint64_t key) {
+            return static_cast<uint32_t>((key >> PROGRAM_SHIFT) & ((uint64_t(1) << PROGRAM_BITS) - 1));
+        }
+
+        // quantizes a view space distance in [near, far] to the depth field; front to back by default,
+        // back to front flips it for blended passes
+        inline uint32_t depth(float distance, float near, float far, bool back_to_front = false) {
+            const uint32_t max = (uint32_t(1) << DEPTH_BITS) - 1;
+            float t = std::clamp((distance - near) / (far - near), 0.0f, 1.0f);
+            uint32_t quantized = static_cast<uint32_t>(t * max);
+            return back_to_front ? max - quantized : quantized;
+        }
+    }
+
+    // one mesh to draw: the key and just enough to find the draw data again after sorting
+    struct DrawPacket {
+        uint64_t key;
+        uint32_t item; // index into the frame's draw list
+        uint32_t mesh; // index into that item's model
+    };
+
+    // Collects draw packets for one frame and sorts them by key. Packets and the sort's scratch buffer
+    // come from the given memory resource, usually the render thread's frame arena.
+    class RenderQueue {
+    public:
+        explicit RenderQueue(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : packets(resource) {}
+
+        void reserve(size_t count) {
+            packets.reserve(count);
+        }
+
+        void push(uint64_t key, uint32_t item, uint32_t mesh) {
+            packets.push_back({key, item, mesh});
+        }
+
+        // LSD radix sort on 8 bit digits. All eight histograms are built in a single pass and digits every
+        // key agrees on are skipped, so a frame whose keys only differ in a few fields sorts in a few passes.
+        // Stable, so packets with equal keys keep their submission order.
+        void sort() {
+            const size_t count = packets.size();
+            if (count < 2)
+                return;
+
+            std::array<std::array<uint32_t, 256>, 8> histograms{};
+            for (const DrawPacket& packet : packets) {
+                for (unsigned int digit = 0; digit < 8; digit++)
+                    histograms[digit][(packet.key >> (digit * 8)) & 0xff]++;
+            }
+
+            std::pmr::vector<DrawPacket> scratch(count, packets.get_allocator());
+            DrawPacket* source = packets.data();
+            DrawPacket* target = scratch.data();
+            for (unsigned int digit = 0; digit < 8; digit++) {
+                std::array<uint32_t, 256>& histogram = histograms[digit];
+                if (histogram[(source[0].key >> (digit * 8)) & 0xff] == count)
+                    continue;
+
+                uint32_t offset = 0;
+                for (uint32_t& bucket : histogram) {
+                    uint32_t size = bucket;
+                    bucket = offset;
+                    offset += size;
+                }
+                for (size_t i = 0; i < count; i++)
+                    target[histogram[(source[i].key >> (digit * 8)) & 0xff]++] = source[i];
+                std::swap(source, target);
+            }
+
+            if (source != packets.data())
+                std::copy(source, source + count, packets.data());
+        }
+
+        // drops the packets, call before the memory resource is rewound
+        void clear() {
+            packets = std::pmr::vector<DrawPacket>(packets.get_allocator());
+        }
+
+        std::span<const DrawPacket> sorted() const {
+            return packets;
+        }
+
+        size_t size() const {
+            return packets.size();
+        }
+
+    private:
+        std::pmr::vector<DrawPacket> packets;
+    };
+
+    // Remembers what the executor last bound in each state slot, so a sorted queue only pays for the
+    // state that actually changes. Counts binds issued and binds skipped for the render stats.
+    class DrawState {
+    public:
+        // meshes need no slot, they all share the static geometry's vertex array; PASS is the pass's
+        // depth and blend state
+        enum Slot { PROGRAM, MATERIAL, PASS, SLOT_COUNT };
+
+        // true when value differs from what the slot holds, i.e. the caller has to bind it
+        bool change(Slot slot, uint32_t value) {
+            if (bound[slot] == value) {
+                saved[slot]++;
+                return false;
+            }
+            bound[slot] = value;
+            binds[slot]++;
+            return true;
+        }
+
+        // forget a slot, e.g. materials after a program change since sampler uniforms are per program
+        void invalidate(Slot slot) {
+            bound[slot] = UNBOUND;
+        }
+
+        void reset() {
+            bound.fill(UNBOUND);
+            binds.fill(0);
+            saved.fill(0);
+        }
+
+        unsigned int bind_count(Slot slot) const { return binds[slot]; }
+        unsigned int saved_count(Slot slot) const { return saved[slot]; }
+
+    private:
+        static const uint32_t UNBOUND = UINT32_MAX;
+
+        std::array<uint32_t, SLOT_COUNT> bound = {UNBOUND, UNBOUND, UNBOUND};
+        std::array<unsigned int, SLOT_COUNT> binds{};
+        std::array<unsigned int, SLOT_COUNT> saved{};
+    };
+}
+
+#endif
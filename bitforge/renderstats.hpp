@@ -0,0 +1,51 @@
+#ifndef RENDERSTATS_H
+#define RENDERSTATS_H
+
+#include <atomic>
+
+namespace BitForge {
+    // Counters of the last frame the render thread finished, published once per frame so other
+    // threads (e.g. an fps counter update) can read them without touching render state.
+    struct RenderStats {
+        std::atomic<unsigned int> uniform_lookups{0}; // uniform locations resolved by name
+
+        // frustum culling on the CPU: meshes tested and meshes outside the frustum
+        std::atomic<unsigned int> meshes_tested{0};
+        std::atomic<unsigned int> meshes_culled{0};
+
+        // software occlusion culling: meshes inside the frustum hidden by occluders, occluder triangles
+        // rasterized and the time spent rasterizing and testing
+        std::atomic<unsigned int> meshes_occluded{0};
+        std::atomic<unsigned int> occluder_triangles{0};
+        std::atomic<unsigned int> occlusion_us{0};
+
+        // render queue: packets submitted, state binds issued and binds skipped because the state was already bound
+        std::atomic<unsigned int> draw_packets{0};
+        std::atomic<unsigned int> draw_commands{0}; // indirect commands, one per run of instances of a mesh
+        std::atomic<unsigned int> draw_calls{0}; // multi-draw calls submitting those commands, over both occlusion phases
+        std::atomic<unsigned int> state_changes{0};
+        std::atomic<unsigned int> state_changes_saved{0};
+
+        // GL state cache: state changing calls passed to the driver and calls skipped as redundant
+        std::atomic<unsigned int> gl_calls{0};
+        std::atomic<unsigned int> gl_calls_elided{0};
+
+        // fragments shaded by the main passes per pixel of the window, 100 when every pixel is shaded once;
+        // a few frames old as the GPU query is read back without waiting
+        std::atomic<unsigned int> overdraw_percent{0};
+
+        // render graph: video memory of the pooled render targets, transient targets share it
+        std::atomic<unsigned int> render_target_kb{0};
+
+        // dynamic resolution: the scale the scene renders at and the smoothed GPU time it is chosen from
+        std::atomic<unsigned int> resolution_percent{100};
+        std::atomic<unsigned int> gpu_frame_us{0};
+    };
+
+    inline RenderStats& render_stats() {
+        static RenderStats stats;
+        return stats;
+    }
+}
+
+#endif
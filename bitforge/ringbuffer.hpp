@@ -0,0 +1,196 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <glad/glad.h>
+
+#include <glresource.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <vector>
+
+namespace BitForge {
+    // a piece of a DynamicRingBuffer, written through data and read by the GPU at buffer + offset
+    struct RingAllocation {
+        void* data = nullptr;
+        GLuint buffer = 0;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+
+        // binds the piece to an indexed binding point (uniform or shader storage)
+        void bindRange(GLenum target, GLuint binding) const {
+            glBindBufferRange(target, binding, buffer, offset, size);
+        }
+
+        template <typename T>
+        std::span<T> as(size_t count) const {
+            return {static_cast<T*>(data), count};
+        }
+    };
+
+    // Memory for data the CPU writes every frame (uniform blocks, instances, commands, streamed vertices).
+    // One buffer created with glBufferStorage and mapped once, persistently and coherently, split into one
+    // region per frame in flight. A frame bumps through its region; before a region is reused,
+    // begin_frame() waits on the fence end_frame() left behind when the region was last submitted, so the
+    // CPU never overwrites what the GPU may still read and the driver never has to sync or orphan.
+    //
+    // A frame that does not fit grows the ring: the old buffer stays alive (its earlier allocations stay
+    // valid) until the GPU is done with it. Only used on the thread owning the GL context.
+    class DynamicRingBuffer {
+    public:
+        explicit DynamicRingBuffer(size_t region_size = 4 * 1024 * 1024, unsigned int frames = 3) : frames(std::max(frames, 1u)) {
+            GLint alignment;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            uniform_align = static_cast<size_t>(alignment);
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            storage_align = static_cast<size_t>(alignment);
+            create(region_size);
+        }
+
+        ~DynamicRingBuffer() {
+            for (GLsync& fence : fences)
+                release(fence);
+            for (Retired& retired : retired_buffers) {
+                release(retired.fence);
+                unmap(retired.buffer);
+            }
+            unmap(buffer);
+        }
+
+        DynamicRingBuffer(const DynamicRingBuffer&) = delete;
+        DynamicRingBuffer& operator=(const DynamicRingBuffer&) = delete;
+
+        // moves to the next region, waiting until the GPU has finished the frame that last used it
+        void begin_frame() {
+            region = (region + 1) % frames;
+            wait(fences[region]);
+            head = 0;
+
+            // buffers replaced by growing go away once their last frame is done
+            std::erase_if(retired_buffers, [](Retired& retired) {
+                if (!retired.fence || !signaled(retired.fence))
+                    return false;
+                release(retired.fence);
+                unmap(retired.buffer);
+                return true;
+            });
+        }
+
+        // fences everything submitted from the current region, and buffers replaced during the frame
+        // along with it: draws issued after growing may still read what was written before
+        void end_frame() {
+            release(fences[region]);
+            fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            for (Retired& retired : retired_buffers) {
+                if (!retired.fence)
+                    retired.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            }
+        }
+
+        // size bytes at a multiple of alignment (a power of two), valid until the region comes around again
+        RingAllocation allocate(size_t size, size_t alignment = 16) {
+            size = std::max<size_t>(size, 1);
+            size_t offset = align(head, alignment);
+            if (offset + size > region_size) {
+                grow(std::max(region_size * 2, size + alignment));
+                offset = 0;
+            }
+            head = offset + size;
+
+            RingAllocation allocation;
+            allocation.buffer = buffer.get();
+            allocation.offset = static_cast<GLintptr>(region * region_size + offset);
+            allocation.size = static_cast<GLsizeiptr>(size);
+            allocation.data = mapped + allocation.offset;
+            return allocation;
+        }
+
+        // count elements of T laid out for a uniform block or a storage buffer binding
+        template <typename T>
+        RingAllocation allocate_uniform(size_t count = 1) {
+            return allocate(count * sizeof(T), std::max(uniform_align, alignof(T)));
+        }
+
+        template <typename T>
+        RingAllocation allocate_storage(size_t count) {
+            return allocate(count * sizeof(T), std::max(storage_align, alignof(T)));
+        }
+
+        GLuint id() const { return buffer.get(); }
+
+    private:
+        struct Retired {
+            BufferHandle buffer;
+            // set by the end_frame() of the frame that replaced it
+            GLsync fence = nullptr;
+        };
+
+        BufferHandle buffer;
+        std::byte* mapped = nullptr;
+        size_t region_size = 0;
+        unsigned int frames;
+        unsigned int region = 0;
+        size_t head = 0;
+        size_t uniform_align = 256;
+        size_t storage_align = 256;
+        std::vector<GLsync> fences;
+        std::vector<Retired> retired_buffers;
+
+        static size_t align(size_t value, size_t alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        void create(size_t size) {
+            region_size = align(size, 256);
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            buffer = create_buffer(region_size * frames, nullptr, flags);
+            mapped = static_cast<std::byte*>(glMapNamedBufferRange(buffer.get(), 0, region_size * frames, flags));
+            fences.assign(frames, nullptr);
+            region = 0;
+            head = 0;
+        }
+
+        // replaces the buffer with a bigger one, the current frame continues in its first region; the
+        // old one is fenced at the end of the frame, which also covers the earlier frames it holds
+        void grow(size_t size) {
+            for (GLsync& fence : fences)
+                release(fence);
+            retired_buffers.push_back({std::move(buffer)});
+            create(size);
+        }
+
+        static void wait(GLsync fence) {
+            if (!fence)
+                return;
+            // flushing makes sure the fence is submitted at all, otherwise the wait could never end
+            while (true) {
+                GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+                if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+                    return;
+            }
+        }
+
+        static bool signaled(GLsync fence) {
+            GLint status = GL_UNSIGNALED;
+            glGetSynciv(fence, GL_SYNC_STATUS, 1, NULL, &status);
+            return status == GL_SIGNALED;
+        }
+
+        static void release(GLsync& fence) {
+            if (fence)
+                glDeleteSync(fence);
+            fence = nullptr;
+        }
+
+        // the handle deletes the buffer afterwards
+        static void unmap(const BufferHandle& buffer) {
+            if (buffer)
+                glUnmapNamedBuffer(buffer.get());
+        }
+    };
+}
+
+#endif
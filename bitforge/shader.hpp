@@ -4,18 +4,35 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include <glstate.hpp>
+
+#include <atomic>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 
+// location of one uniform in one program, resolved ahead of time; -1 (inactive) is silently ignored by GL
+struct UniformHandle
+{
+    GLint location = -1;
+
+    bool valid() const { return location >= 0; }
+};
+
 class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // name lookups made through uniform() since the counter was last reset, hot paths should cause none
+    inline static std::atomic<unsigned int> lookups{0};
+    // constructor generates the shader on the fly; defines (e.g. "#define INSTANCED\n") are inserted
+    // after the #version line of both stages to compile a variant of the same sources
     // ------------------------------------------------------------------------
-    Shader(std::string name)
+    Shader(std::string name, std::string_view defines = {})
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -40,6 +57,8 @@ public:
             // convert stream into string
             vertexCode = vShaderStream.str();
             fragmentCode = fShaderStream.str();			
+            insertDefines(vertexCode, defines);
+            insertDefines(fragmentCode, defines);
         }
         catch (std::ifstream::failure& e)
         {
@@ -65,77 +84,225 @@ public:
         glAttachShader(ID, fragment);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
 
     }
+    // compute program from resources/shaders/<name>.comp, defines work as for the constructor
+    // ------------------------------------------------------------------------
+    static Shader compute(std::string name, std::string_view defines = {})
+    {
+        return Shader(ComputeStage{}, name, defines);
+    }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() const
     { 
-        glUseProgram(ID); 
+        BitForge::gl_state().useProgram(ID);
+    }
+    // uniform lookup
+    // ------------------------------------------------------------------------
+    // resolves a name through the table reflected at link time, no driver call; counted in lookups
+    UniformHandle uniform(const char* name) const
+    {
+        lookups.fetch_add(1, std::memory_order_relaxed);
+        auto it = locations.find(std::string_view(name));
+        return it != locations.end() ? UniformHandle{it->second} : UniformHandle{};
+    }
+    // utility uniform functions, by handle (hot paths)
+    // ------------------------------------------------------------------------
+    void setBool(UniformHandle handle, bool value) const
+    {
+        glUniform1i(handle.location, (int)value);
+    }
+    void setInt(UniformHandle handle, int value) const
+    {
+        glUniform1i(handle.location, value);
     }
-    // utility uniform functions
+    void setFloat(UniformHandle handle, float value) const
+    {
+        glUniform1f(handle.location, value);
+    }
+    void setVec2(UniformHandle handle, const glm::vec2 &value) const
+    {
+        glUniform2fv(handle.location, 1, &value[0]);
+    }
+    void setVec3(UniformHandle handle, const glm::vec3 &value) const
+    {
+        glUniform3fv(handle.location, 1, &value[0]);
+    }
+    void setVec4(UniformHandle handle, const glm::vec4 &value) const
+    {
+        glUniform4fv(handle.location, 1, &value[0]);
+    }
+    void setMat2(UniformHandle handle, const glm::mat2 &mat) const
+    {
+        glUniformMatrix2fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat3(UniformHandle handle, const glm::mat3 &mat) const
+    {
+        glUniformMatrix3fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    void setMat4(UniformHandle handle, const glm::mat4 &mat) const
+    {
+        glUniformMatrix4fv(handle.location, 1, GL_FALSE, &mat[0][0]);
+    }
+    // utility uniform functions, by name (setup code)
     // ------------------------------------------------------------------------
-    void setBool(const std::string &name, bool value) const
+    void setBool(const char* name, bool value) const
     {         
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+        setBool(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setInt(const std::string &name, int value) const
+    void setInt(const char* name, int value) const
     { 
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+        setInt(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setFloat(const std::string &name, float value) const
+    void setFloat(const char* name, float value) const
     { 
-        glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+        setFloat(uniform(name), value);
     }
     // ------------------------------------------------------------------------
-    void setVec2(const std::string &name, const glm::vec2 &value) const
+    void setVec2(const char* name, const glm::vec2 &value) const
     { 
-        glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec2(uniform(name), value);
     }
-    void setVec2(const std::string &name, float x, float y) const
+    void setVec2(const char* name, float x, float y) const
     { 
-        glUniform2f(glGetUniformLocation(ID, name.c_str()), x, y); 
+        setVec2(uniform(name), glm::vec2(x, y));
     }
     // ------------------------------------------------------------------------
-    void setVec3(const std::string &name, const glm::vec3 &value) const
+    void setVec3(const char* name, const glm::vec3 &value) const
     { 
-        glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec3(uniform(name), value);
     }
-    void setVec3(const std::string &name, float x, float y, float z) const
+    void setVec3(const char* name, float x, float y, float z) const
     { 
-        glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+        setVec3(uniform(name), glm::vec3(x, y, z));
     }
     // ------------------------------------------------------------------------
-    void setVec4(const std::string &name, const glm::vec4 &value) const
+    void setVec4(const char* name, const glm::vec4 &value) const
     { 
-        glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &value[0]); 
+        setVec4(uniform(name), value);
     }
-    void setVec4(const std::string &name, float x, float y, float z, float w) const
+    void setVec4(const char* name, float x, float y, float z, float w) const
     { 
-        glUniform4f(glGetUniformLocation(ID, name.c_str()), x, y, z, w); 
+        setVec4(uniform(name), glm::vec4(x, y, z, w));
     }
     // ------------------------------------------------------------------------
-    void setMat2(const std::string &name, const glm::mat2 &mat) const
+    void setMat2(const char* name, const glm::mat2 &mat) const
     {
-        glUniformMatrix2fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat2(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat3(const std::string &name, const glm::mat3 &mat) const
+    void setMat3(const char* name, const glm::mat3 &mat) const
     {
-        glUniformMatrix3fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat3(uniform(name), mat);
     }
     // ------------------------------------------------------------------------
-    void setMat4(const std::string &name, const glm::mat4 &mat) const
+    void setMat4(const char* name, const glm::mat4 &mat) const
     {
-        glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
+        setMat4(uniform(name), mat);
     }
 
 private:
+    struct ComputeStage {};
+
+    Shader(ComputeStage, std::string name, std::string_view defines)
+    {
+        std::string computeCode;
+        std::ifstream cShaderFile;
+        cShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try
+        {
+            cShaderFile.open("resources/shaders/" + name + ".comp");
+            std::stringstream cShaderStream;
+            cShaderStream << cShaderFile.rdbuf();
+            cShaderFile.close();
+            computeCode = cShaderStream.str();
+            insertDefines(computeCode, defines);
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+        }
+        const char* cShaderCode = computeCode.c_str();
+        unsigned int compute = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(compute, 1, &cShaderCode, NULL);
+        glCompileShader(compute);
+        checkCompileErrors(compute, "COMPUTE");
+        ID = glCreateProgram();
+        glAttachShader(ID, compute);
+        glLinkProgram(ID);
+        checkCompileErrors(ID, "PROGRAM");
+        reflectUniforms();
+        glDeleteShader(compute);
+    }
+
+    // transparent hashing so lookups by const char* never build a std::string
+    struct NameHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view name) const { return std::hash<std::string_view>()(name); }
+    };
+
+    std::unordered_map<std::string, GLint, NameHash, std::equal_to<>> locations;
+
+    // fills the location table from the program's active uniforms; arrays of basic types are reported
+    // once as "name[0]", so every element and the bare name get their own entry
+    void reflectUniforms()
+    {
+        GLint count = 0;
+        glGetProgramInterfaceiv(ID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &count);
+        const GLenum properties[] = { GL_NAME_LENGTH, GL_LOCATION, GL_ARRAY_SIZE };
+        std::string name;
+        for (GLint i = 0; i < count; i++)
+        {
+            GLint values[3];
+            glGetProgramResourceiv(ID, GL_UNIFORM, i, 3, properties, 3, NULL, values);
+            // members of uniform blocks have no location
+            if (values[1] < 0)
+                continue;
+
+            name.resize(values[0]);
+            glGetProgramResourceName(ID, GL_UNIFORM, i, values[0], NULL, name.data());
+            name.resize(values[0] - 1);
+            locations[name] = values[1];
+
+            if (name.size() > 3 && name.ends_with("[0]"))
+            {
+                std::string base = name.substr(0, name.size() - 3);
+                locations[base] = values[1];
+                for (GLint element = 1; element < values[2]; element++)
+                    locations[base + "[" + std::to_string(element) + "]"] = values[1] + element;
+            }
+        }
+    }
+
+    // puts the defines right after the #version line, which has to stay first; at the top without one
+    // ------------------------------------------------------------------------
+    static void insertDefines(std::string& code, std::string_view defines)
+    {
+        if (defines.empty())
+            return;
+        size_t version = code.find("#version");
+        if (version == std::string::npos)
+        {
+            code.insert(0, defines);
+            return;
+        }
+        size_t end = code.find('\n', version);
+        if (end == std::string::npos)
+        {
+            code += '\n';
+            end = code.size() - 1;
+        }
+        code.insert(end + 1, defines);
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
@@ -0,0 +1,64 @@
+#ifndef STREAMBUFFER_H
+#define STREAMBUFFER_H
+
+#include <glad/glad.h>
+
+#include <glresource.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+
+namespace BitForge {
+    // GPU array of T rewritten every frame (instances, indirect commands, per-draw data). Each upload
+    // orphans the old storage instead of overwriting it, so it never waits on draws still reading the
+    // previous frame's contents, and grows the buffer when needed.
+    template <typename T>
+    class StreamBuffer {
+    public:
+        explicit StreamBuffer(GLenum target, size_t capacity = 1024)
+            : buffer(create_mutable_buffer()), target(target), capacity(std::max<size_t>(capacity, 1)) {
+            glNamedBufferData(buffer.get(), this->capacity * sizeof(T), NULL, GL_STREAM_DRAW);
+        }
+
+        void upload(std::span<const T> data) {
+            if (data.size() > capacity)
+                capacity = std::max(data.size(), capacity * 2);
+            count = data.size();
+
+            glNamedBufferData(buffer.get(), capacity * sizeof(T), NULL, GL_STREAM_DRAW);
+            if (count > 0)
+                glNamedBufferSubData(buffer.get(), 0, count * sizeof(T), data.data());
+        }
+
+        // storage for count elements the GPU writes itself, previous contents are dropped
+        void resize(size_t count) {
+            if (count > capacity)
+                capacity = std::max(count, capacity * 2);
+            this->count = count;
+
+            glNamedBufferData(buffer.get(), capacity * sizeof(T), NULL, GL_STREAM_DRAW);
+        }
+
+        // binds to the buffer's target, e.g. GL_DRAW_INDIRECT_BUFFER before an indirect draw
+        void bind() const {
+            glBindBuffer(target, buffer.get());
+        }
+
+        // binds to an indexed binding point of the target (storage or uniform buffers)
+        void bindBase(GLuint binding) const {
+            glBindBufferBase(target, binding, buffer.get());
+        }
+
+        size_t size() const { return count; }
+        GLuint id() const { return buffer.get(); }
+
+    private:
+        BufferHandle buffer;
+        GLenum target;
+        size_t capacity;
+        size_t count = 0;
+    };
+}
+
+#endif
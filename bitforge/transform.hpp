@@ -0,0 +1,100 @@
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+struct Transform {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+
+    // model matrix: translate, then rotate, then scale
+    glm::mat4 matrix() const
+    {
+        glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
+        model *= glm::mat4_cast(rotation);
+        return glm::scale(model, scale);
+    }
+
+    // inverse transpose of matrix()'s upper 3x3, which for rotate-then-scale is the rotation with the
+    // scale inverted; no general matrix inverse needed
+    glm::mat3 normal_matrix() const
+    {
+        glm::mat3 normal = glm::mat3_cast(rotation);
+        normal[0] /= scale.x;
+        normal[1] /= scale.y;
+        normal[2] /= scale.z;
+        return normal;
+    }
+
+    // blends two simulation states, t = 0 gives a and t = 1 gives b
+    static Transform interpolate(const Transform& a, const Transform& b, float t)
+    {
+        Transform result;
+        result.position = glm::mix(a.position, b.position, t);
+        result.rotation = glm::slerp(a.rotation, b.rotation, t);
+        result.scale = glm::mix(a.scale, b.scale, t);
+        return result;
+    }
+};
+
+class InterpolatedTransform;
+
+namespace BitForge {
+    void track_interpolated(InterpolatedTransform* transform);
+    void untrack_interpolated(InterpolatedTransform* transform);
+}
+
+// A transform written by fixed-step updates and read by the renderer. The engine saves the current
+// state as the previous one before every tick, so rendering at() the leftover tick fraction
+// moves objects smoothly even when several frames share one tick or one frame runs several.
+class InterpolatedTransform
+{
+public:
+    Transform previous;
+    Transform current;
+
+    InterpolatedTransform(const Transform& initial = Transform()) : previous(initial), current(initial)
+    {
+        BitForge::track_interpolated(this);
+    }
+
+    InterpolatedTransform(const InterpolatedTransform& other) : previous(other.previous), current(other.current)
+    {
+        BitForge::track_interpolated(this);
+    }
+
+    InterpolatedTransform& operator=(const InterpolatedTransform& other)
+    {
+        previous = other.previous;
+        current = other.current;
+        return *this;
+    }
+
+    ~InterpolatedTransform()
+    {
+        BitForge::untrack_interpolated(this);
+    }
+
+    // called by the engine before each simulation tick
+    void snapshot()
+    {
+        previous = current;
+    }
+
+    // moves the object without interpolating from its old place (spawns, teleports)
+    void teleport(const Transform& transform)
+    {
+        previous = transform;
+        current = transform;
+    }
+
+    Transform at(float alpha) const
+    {
+        return Transform::interpolate(previous, current, alpha);
+    }
+};
+
+#endif
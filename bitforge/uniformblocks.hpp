@@ -0,0 +1,110 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <ringbuffer.hpp>
+
+#include <cstddef>
+#include <cstring>
+
+// Per-frame data shared by every program through std140 uniform blocks at fixed binding points.
+// The structs below mirror the GLSL declarations byte for byte: every vec3 is followed by a float
+// (a real member or padding) because std140 aligns vec3 to 16 bytes.
+namespace BitForge {
+    enum UniformBinding : GLuint {
+        VIEW_BINDING = 1,    // layout(std140, binding = 1) uniform View
+        LIGHT_BINDING = 2    // layout(std140, binding = 2) uniform Lights
+    };
+
+    // shader storage buffers, layout(std430, binding = ...) buffer
+    enum StorageBinding : GLuint {
+        INSTANCE_BINDING = 0,           // Instances, see instancebatch.hpp
+        DRAW_BINDING = 1,               // Draws, per-draw data of indirect multi-draws
+        // GPU culling, see gpuculling.hpp and cull.comp
+        CULL_COMMAND_BINDING = 2,       // CullCommands, commands with bounds, instance counts filled by culling
+        INSTANCE_CULL_BINDING = 3,      // InstanceCulls, command and object of each instance
+        VISIBLE_BINDING = 4,            // Visible, surviving instance indices per command, read by CULLED variants
+        DRAW_INPUT_BINDING = 5,         // DrawInputs, per-draw data before compaction
+        COMPACTED_BINDING = 6,          // Compacted, commands with visible instances, packed per batch
+        BATCH_COUNT_BINDING = 7,        // BatchCounts, compacted commands per batch, the draw count parameter
+        HISTORY_BINDING = 8,            // History, per object and mesh whether it was visible last frame
+        NEXT_HISTORY_BINDING = 9,       // NextHistory, the same for this frame, written by phase 2
+        MATERIAL_BINDING = 10           // Materials, texture layers and parameters, see materiallibrary.hpp
+    };
+
+    const int NR_POINT_LIGHTS = 1; // keep in sync with default.frag
+
+    struct ViewBlock {
+        glm::mat4 projection;
+        glm::mat4 view;
+        glm::vec3 position;
+        float padding0;
+        glm::vec3 front;
+        float padding1;
+    };
+
+    struct DirLightBlock {
+        glm::vec3 direction;
+        float padding0;
+        glm::vec3 ambient;
+        float padding1;
+        glm::vec3 diffuse;
+        float padding2;
+        glm::vec3 specular;
+        float padding3;
+    };
+
+    struct PointLightBlock {
+        glm::vec3 position;
+        float constant;
+        glm::vec3 ambient;
+        float linear;
+        glm::vec3 diffuse;
+        float quadratic;
+        glm::vec3 specular;
+        float padding;
+    };
+
+    struct SpotLightBlock {
+        glm::vec3 position;
+        float cutOff;
+        glm::vec3 direction;
+        float outerCutOff;
+        glm::vec3 ambient;
+        float constant;
+        glm::vec3 diffuse;
+        float linear;
+        glm::vec3 specular;
+        float quadratic;
+    };
+
+    struct LightBlock {
+        DirLightBlock dirLight;
+        PointLightBlock pointLights[NR_POINT_LIGHTS];
+        SpotLightBlock spotLight;
+    };
+
+    static_assert(sizeof(ViewBlock) == 160 && offsetof(ViewBlock, position) == 128);
+    static_assert(sizeof(DirLightBlock) == 64 && sizeof(PointLightBlock) == 64 && sizeof(SpotLightBlock) == 80);
+    static_assert(offsetof(LightBlock, spotLight) == 64 + 64 * NR_POINT_LIGHTS);
+
+    // a block bound to a fixed binding point, rewritten whole once per frame into the frame's ring region
+    template <typename T>
+    class UniformBlock {
+    public:
+        explicit UniformBlock(GLuint binding) : binding(binding) {}
+
+        void upload(DynamicRingBuffer& ring, const T& data) {
+            RingAllocation allocation = ring.allocate_uniform<T>();
+            std::memcpy(allocation.data, &data, sizeof(T));
+            allocation.bindRange(GL_UNIFORM_BUFFER, binding);
+        }
+
+    private:
+        GLuint binding;
+    };
+}
+
+#endif
@@ -0,0 +1,130 @@
+// Streams geometry the CPU rewrites every frame through a DynamicRingBuffer: a sheet of waves is
+// generated each frame, copied into the frame's ring region by DynamicMesh::update() and drawn from
+// there. Run from a directory holding resources/, like the engine.
+#include <glad/glad.h>
+#include <glfw/glfw3.h>
+
+#include <dynamicmesh.hpp>
+#include <ringbuffer.hpp>
+#include <shader.hpp>
+#include <uniformblocks.hpp>
+
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+const unsigned int scr_width = 1280;
+const unsigned int scr_height = 720;
+
+// a square sheet of waves at time seconds, the indices are only built on the first call
+void wave_surface(double time, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+{
+    const unsigned int cells = 32;
+    const float size = 4.0f, height = 0.08f, frequency = 3.0f;
+    // both waves repeat after 4 pi seconds; wrapped before going to float, so they stay smooth however
+    // long the program runs
+    float phase = static_cast<float>(std::fmod(time, 4.0 * glm::pi<double>()));
+
+    vertices.resize((cells + 1) * (cells + 1));
+    for (unsigned int z = 0; z <= cells; z++)
+    {
+        for (unsigned int x = 0; x <= cells; x++)
+        {
+            glm::vec2 uv(float(x) / cells, float(z) / cells);
+            glm::vec2 position = (uv - 0.5f) * size;
+            float u = frequency * position.x + 2.0f * phase, v = frequency * position.y + 1.5f * phase;
+            // y = height * sin(u) * cos(v), the normal follows from its slopes
+            float dx = height * frequency * std::cos(u) * std::cos(v);
+            float dz = -height * frequency * std::sin(u) * std::sin(v);
+
+            Vertex& vertex = vertices[z * (cells + 1) + x];
+            vertex = Vertex{};
+            vertex.Position = glm::vec3(position.x, height * std::sin(u) * std::cos(v), position.y);
+            vertex.Normal = glm::normalize(glm::vec3(-dx, 1.0f, -dz));
+            vertex.TexCoords = uv;
+        }
+    }
+
+    if (!indices.empty())
+        return;
+    indices.reserve(cells * cells * 6);
+    for (unsigned int z = 0; z < cells; z++)
+    {
+        for (unsigned int x = 0; x < cells; x++)
+        {
+            // counter clockwise seen from above
+            unsigned int corner = z * (cells + 1) + x;
+            indices.insert(indices.end(), {corner, corner + cells + 1, corner + 1, corner + 1, corner + cells + 1, corner + cells + 2});
+        }
+    }
+}
+
+int main()
+{
+    // glfw and glad
+    // -------------
+    glfwInit();
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+    GLFWwindow* window = glfwCreateWindow(scr_width, scr_height, "BitForge - dynamic mesh", NULL, NULL);
+    if (window == NULL)
+    {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return -1;
+    }
+    glfwMakeContextCurrent(window);
+
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    BitForge::gl_state().enable(GL_DEPTH_TEST);
+
+    {
+        // the light program only needs the View block and a model matrix
+        Shader shader("light");
+        UniformHandle model_uniform = shader.uniform("model");
+        BitForge::DynamicRingBuffer ring;
+        BitForge::UniformBlock<BitForge::ViewBlock> view_uniforms(BitForge::VIEW_BINDING);
+        DynamicMesh mesh;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+
+        BitForge::ViewBlock view{};
+        view.projection = glm::perspective(glm::radians(45.0f), (float)scr_width / (float)scr_height, 0.1f, 100.0f);
+        view.position = glm::vec3(0.0f, 2.5f, 4.0f);
+        view.view = glm::lookAt(view.position, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        view.front = glm::normalize(-view.position);
+
+        // render loop
+        // -----------
+        while (!glfwWindowShouldClose(window))
+        {
+            glfwPollEvents();
+
+            // waits only if the GPU still reads the region this frame is about to reuse
+            ring.begin_frame();
+            view_uniforms.upload(ring, view);
+            wave_surface(glfwGetTime(), vertices, indices);
+            mesh.update(ring, vertices, indices);
+
+            glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+            shader.use();
+            shader.setMat4(model_uniform, glm::mat4(1.0f));
+            mesh.draw(shader);
+
+            // everything reading this frame's region is submitted
+            ring.end_frame();
+            glfwSwapBuffers(window);
+        }
+    }
+
+    glfwTerminate();
+    return 0;
+}
@@ -1,12 +1,15 @@
 #version 460 core
+#ifdef TRANSPARENT
+// weighted blended order independent transparency (McGuire and Bavoil): premultiplied color times a
+// weight summed in accum, the product of (1 - alpha) in revealage; framebuffer.frag composites them
+layout (location = 0) out vec4 accum;
+layout (location = 1) out float revealage;
+#else
 out vec4 FragColor;
+#endif
 
-struct Material {
-    sampler2D diffuse;
-    sampler2D specular;
-    float shininess;
-}; 
-
+// light structs are ordered so every vec3 shares its std140 16 byte slot with a float,
+// see uniformblocks.hpp for the matching C++ layout
 struct DirLight {
     vec3 direction;
 	
@@ -17,29 +20,25 @@ struct DirLight {
 
 struct PointLight {
     vec3 position;
-    
     float constant;
-    float linear;
-    float quadratic;
-	
     vec3 ambient;
+    float linear;
     vec3 diffuse;
+    float quadratic;
     vec3 specular;
 };
 
 struct SpotLight {
     vec3 position;
-    vec3 direction;
     float cutOff;
+    vec3 direction;
     float outerCutOff;
-  
+    vec3 ambient;
     float constant;
+    vec3 diffuse;
     float linear;
+    vec3 specular;
     float quadratic;
-  
-    vec3 ambient;
-    vec3 diffuse;
-    vec3 specular;       
 };
 
 #define NR_POINT_LIGHTS 1
@@ -48,11 +47,83 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-uniform vec3 viewPos;
-uniform DirLight dirLight;
-uniform PointLight pointLights[NR_POINT_LIGHTS];
-uniform SpotLight spotLight;
-uniform Material material;
+layout (std140, binding = 1) uniform View
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 viewFront;
+};
+
+layout (std140, binding = 2) uniform Lights
+{
+    DirLight dirLight;
+    PointLight pointLights[NR_POINT_LIGHTS];
+    SpotLight spotLight;
+};
+
+// every material texture is a layer of one of these arrays, see materiallibrary.hpp
+layout (binding = 0) uniform sampler2DArray materialArrays[8];
+
+// textures are the array index shifted left by 16 plus the layer, -1 for none
+struct MaterialData
+{
+    ivec4 textures; // diffuse, specular, normal, height
+    float shininess;
+    float opacity;
+};
+
+layout (std430, binding = 10) readonly buffer Materials
+{
+    MaterialData materials[];
+};
+
+#ifdef INDIRECT
+// per-draw parameters of a multi-draw, the vertex shader passes down which entry is ours; the same 16 byte
+// layout as DrawData in cull.comp and instancebatch.hpp
+struct DrawData
+{
+    uint material;
+    float shininess;
+    uint padding0;
+    uint padding1;
+};
+
+layout (std430, binding = 1) readonly buffer Draws
+{
+    DrawData draws[];
+};
+
+flat in int DrawIndex;
+#else
+uniform int materialIndex;
+#endif
+
+// the material's specular exponent and texture colors, fetched once per fragment
+float shininess;
+vec4 diffuseColor;
+vec4 specularColor;
+
+// a missing texture reads like an unbound one, opaque black
+vec4 SampleMaterial(int ref, vec2 uv)
+{
+    if (ref < 0)
+        return vec4(0.0, 0.0, 0.0, 1.0);
+    vec3 coords = vec3(uv, float(ref & 0xFFFF));
+    // sampler arrays take constant indices only; a draw reads one material, so every invocation
+    // of a quad takes the same branch
+    switch (ref >> 16)
+    {
+        case 0: return texture(materialArrays[0], coords);
+        case 1: return texture(materialArrays[1], coords);
+        case 2: return texture(materialArrays[2], coords);
+        case 3: return texture(materialArrays[3], coords);
+        case 4: return texture(materialArrays[4], coords);
+        case 5: return texture(materialArrays[5], coords);
+        case 6: return texture(materialArrays[6], coords);
+        default: return texture(materialArrays[7], coords);
+    }
+}
 
 // function prototypes
 vec4 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
@@ -61,7 +132,19 @@ vec4 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 
 void main()
 {
-    if (texture(material.diffuse, TexCoords).a <= 0.05) discard;
+#ifdef INDIRECT
+    MaterialData material = materials[draws[DrawIndex].material];
+    shininess = draws[DrawIndex].shininess;
+#else
+    MaterialData material = materials[materialIndex];
+    shininess = material.shininess;
+#endif
+    diffuseColor = SampleMaterial(material.textures.x, TexCoords);
+#ifdef ALPHA_TEST
+    // only materials with cut out texels discard, a discard anywhere in the shader disables early depth tests
+    if (diffuseColor.a <= 0.05) discard;
+#endif
+    specularColor = SampleMaterial(material.textures.y, TexCoords);
 
     // properties
     vec3 norm = normalize(Normal);
@@ -82,7 +165,15 @@ void main()
     result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
     result.a = min(result.a, 1.0);
 
+#ifdef TRANSPARENT
+    float alpha = clamp(diffuseColor.a * material.opacity, 0.0, 1.0);
+    // nearer and more opaque layers weigh more, so the average leans towards what is in front
+    float weight = clamp(alpha * 3e3 * pow(1.0 - gl_FragCoord.z, 3.0), 1e-2, 3e3);
+    accum = vec4(result.rgb * alpha, alpha) * weight;
+    revealage = alpha;
+#else
     FragColor = result;
+#endif
 }
 
 // calculates the color when using a directional light.
@@ -93,11 +184,11 @@ vec4 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir)
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
     // specular shading
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
     // combine results
-    vec4 ambient = vec4(light.ambient, 1.0) * texture(material.diffuse, TexCoords);
-    vec4 diffuse = vec4(light.diffuse, 1.0) * diff * texture(material.diffuse, TexCoords);
-    vec4 specular = vec4(light.specular, 1.0) * spec * texture(material.specular, TexCoords);
+    vec4 ambient = vec4(light.ambient, 1.0) * diffuseColor;
+    vec4 diffuse = vec4(light.diffuse, 1.0) * diff * diffuseColor;
+    vec4 specular = vec4(light.specular, 1.0) * spec * specularColor;
     return (ambient + diffuse + specular);
 }
 
@@ -109,14 +200,14 @@ vec4 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     // diffuse shading
     float diff = max(dot(normal, lightDir), 0.0);
     // specular shading
-    float spec = pow(max(dot(normal, halfwayDir), 0.0), material.shininess);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
     // combine results
-    vec4 ambient = vec4(light.ambient, 1.0) * texture(material.diffuse, TexCoords);
-    vec4 diffuse = vec4(light.diffuse, 1.0) * diff * texture(material.diffuse, TexCoords);
-    vec4 specular = vec4(light.specular, 1.0) * spec * texture(material.specular, TexCoords);
+    vec4 ambient = vec4(light.ambient, 1.0) * diffuseColor;
+    vec4 diffuse = vec4(light.diffuse, 1.0) * diff * diffuseColor;
+    vec4 specular = vec4(light.specular, 1.0) * spec * specularColor;
     ambient *= attenuation;
     diffuse *= attenuation;
     specular *= attenuation;
@@ -131,7 +222,7 @@ vec4 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float diff = max(dot(normal, lightDir), 0.0);
     // specular shading
     vec3 reflectDir = reflect(-lightDir, normal);
-    float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+    float spec = pow(max(dot(viewDir, reflectDir), 0.0), shininess);
     // attenuation
     float distance = length(light.position - fragPos);
     float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));    
@@ -140,9 +231,9 @@ vec4 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir)
     float epsilon = light.cutOff - light.outerCutOff;
     float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
     // combine results
-    vec4 ambient = vec4(light.ambient, 1.0) * texture(material.diffuse, TexCoords);
-    vec4 diffuse = vec4(light.diffuse, 1.0) * diff * texture(material.diffuse, TexCoords);
-    vec4 specular = vec4(light.specular, 1.0) * spec * texture(material.specular, TexCoords);
+    vec4 ambient = vec4(light.ambient, 1.0) * diffuseColor;
+    vec4 diffuse = vec4(light.diffuse, 1.0) * diff * diffuseColor;
+    vec4 specular = vec4(light.specular, 1.0) * spec * specularColor;
     ambient *= attenuation * intensity;
     diffuse *= attenuation * intensity;
     specular *= attenuation * intensity;
@@ -7,15 +7,67 @@ out vec3 FragPos;
 out vec3 Normal;
 out vec2 TexCoords;
 
+// the depth pre-pass (depth.vert) has to produce bit identical depth for the GL_EQUAL test
+invariant gl_Position;
+
+#ifdef INDIRECT
+#define INSTANCED
+// gl_DrawID restarts at 0 for every multi-draw call, drawOffset is where this call's DrawData begins
+uniform int drawOffset;
+flat out int DrawIndex;
+#endif
+
+#ifdef INSTANCED
+// one entry per instance, indexed by the draw's base instance plus gl_InstanceID
+struct Instance
+{
+    mat4 model;
+    mat3 normal;
+};
+
+layout (std430, binding = 0) readonly buffer Instances
+{
+    Instance instances[];
+};
+
+#ifdef CULLED
+// frustum culling (cull.comp) leaves the surviving instance indices of each draw at its base instance
+layout (std430, binding = 4) readonly buffer Visible
+{
+    uint visible[];
+};
+#define INSTANCE_INDEX visible[gl_BaseInstance + gl_InstanceID]
+#else
+#define INSTANCE_INDEX (gl_BaseInstance + gl_InstanceID)
+#endif
+#else
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
+
+layout (std140, binding = 1) uniform View
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 viewFront;
+};
 
 void main()
 {
-    FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = mat3(transpose(inverse(model))) * aNormal;  
+#ifdef INSTANCED
+    Instance instance = instances[INSTANCE_INDEX];
+    mat4 model = instance.model;
+    mat3 normalMatrix = instance.normal;
+#else
+    mat3 normalMatrix = mat3(transpose(inverse(model)));
+#endif
+#ifdef INDIRECT
+    DrawIndex = drawOffset + gl_DrawID;
+#endif
+    vec4 worldPosition = model * vec4(aPos, 1.0);
+    FragPos = vec3(worldPosition);
+    Normal = normalMatrix * aNormal;
     TexCoords = aTexCoords;
     
-    gl_Position = projection * view * vec4(FragPos, 1.0);
+    gl_Position = projection * view * worldPosition;
 }
\ No newline at end of file
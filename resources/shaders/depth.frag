@@ -0,0 +1,6 @@
+#version 460 core
+
+// depth only, color writes are masked while the pre-pass runs
+void main()
+{
+}
\ No newline at end of file
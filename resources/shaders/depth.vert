@@ -0,0 +1,44 @@
+#version 460 core
+layout (location = 0) in vec3 aPos;
+
+// Depth pre-pass: positions only, computed exactly like default.vert and light.vert so the main
+// pass can test with GL_EQUAL
+invariant gl_Position;
+
+// one entry per instance, indexed by the draw's base instance plus gl_InstanceID
+struct Instance
+{
+    mat4 model;
+    mat3 normal;
+};
+
+layout (std430, binding = 0) readonly buffer Instances
+{
+    Instance instances[];
+};
+
+#ifdef CULLED
+// frustum culling (cull.comp) leaves the surviving instance indices of each draw at its base instance
+layout (std430, binding = 4) readonly buffer Visible
+{
+    uint visible[];
+};
+#define INSTANCE_INDEX visible[gl_BaseInstance + gl_InstanceID]
+#else
+#define INSTANCE_INDEX (gl_BaseInstance + gl_InstanceID)
+#endif
+
+layout (std140, binding = 1) uniform View
+{
+    mat4 projection;
+    mat4 view;
+    vec3 viewPos;
+    vec3 viewFront;
+};
+
+void main()
+{
+    mat4 model = instances[INSTANCE_INDEX].model;
+    vec4 worldPosition = model * vec4(aPos, 1.0);
+    gl_Position = projection * view * worldPosition;
+}
\ No newline at end of file
@@ -4,9 +4,27 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D screenTexture;
+// weighted blended transparency over the opaque scene, see default.frag
+uniform sampler2D accumTexture;
+uniform sampler2D revealageTexture;
+// the part of the targets the scene covers, below 1 while the resolution is scaled down
+uniform vec2 sceneScale;
 
 const float offset = 1.0 / 100.0;  
 
+// the opaque color with the average of the transparent layers over it, weighted by how much they cover
+vec3 Scene(vec2 uv)
+{
+    // bilinear upscale, kept half a texel inside the covered part so nothing stale outside bleeds in
+    vec2 halfTexel = 0.5 / vec2(textureSize(screenTexture, 0));
+    uv = clamp(uv * sceneScale, halfTexel, sceneScale - halfTexel);
+    vec3 opaque = texture(screenTexture, uv).rgb;
+    vec4 accum = texture(accumTexture, uv);
+    float revealage = texture(revealageTexture, uv).r;
+    vec3 average = accum.rgb / max(accum.a, 1e-5);
+    return mix(average, opaque, revealage);
+}
+
 void main()
 {
     // OVERSHARPENING
@@ -31,7 +49,7 @@ void main()
     vec3 sampleTex[9];
     for(int i = 0; i < 9; i++)
     {
-        sampleTex[i] = vec3(texture(screenTexture, TexCoords.st + offsets[i]));
+        sampleTex[i] = Scene(TexCoords.st + offsets[i]);
     }
     vec3 col = vec3(0.0);
     for(int i = 0; i < 9; i++)
@@ -39,5 +57,5 @@ void main()
     
     FragColor = vec4(col, 1.0);
     // NO POSTPROCESSING
-    //FragColor = vec4(vec3(texture(screenTexture, TexCoords)), 1.0);
+    //FragColor = vec4(Scene(TexCoords), 1.0);
 }  
\ No newline at end of file
@@ -2,15 +2,22 @@
 #include <iostream>
 
 namespace {
+    // smoothed frame time, long frames are measured against it
+    double average_delta = 0.0;
+
     void start()
     {
         std::cout << "started" << std::endl;
     }
 
+    // reports frames taking several times the usual frame time on stderr, so it runs next to the fps
+    // counter on stdout instead of after it
     void update(double delta_time)
     {
-        //std::cout << "updated, delta time: " << delta_time << std::endl;
+        if (average_delta > 0.0 && delta_time > 0.05 && delta_time > average_delta * 4.0)
+            std::cerr << "long frame: " << (int)(delta_time * 1000.0) << " ms (usually " << (int)(average_delta * 1000.0) << " ms)" << std::endl;
+        average_delta = average_delta > 0.0 ? average_delta + (delta_time - average_delta) * 0.05 : delta_time;
     }
 }
 
-REGISTER(start, update)
+REGISTER(start, update, .name = "delattime", .phase = BitForge::Phase::PRE_RENDER, .reads = {}, .writes = {"stderr"}, .after = {})
\ No newline at end of file
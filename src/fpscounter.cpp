@@ -1,4 +1,5 @@
 #include <bitforge.hpp>
+#include <renderstats.hpp>
 #include <iostream>
 
 namespace {
@@ -9,8 +10,19 @@ namespace {
 
     void update(double delta_time)
     {
-        std::cout << "fps: " << (int)(1.0 / delta_time) << std::endl;
+        const BitForge::SchedulerStats& stats = BitForge::scheduler_stats();
+        const BitForge::RenderStats& render = BitForge::render_stats();
+        std::cout << "fps: " << (int)(1.0 / delta_time) << " (updates " << (int)(stats.parallel_fraction() * 100.0) << "% parallel on " << stats.threads << " threads"
+                  << ", uniform lookups " << render.uniform_lookups.load(std::memory_order_relaxed)
+                  << ", culled " << render.meshes_culled.load(std::memory_order_relaxed) << " of " << render.meshes_tested.load(std::memory_order_relaxed) << " meshes"
+                  << ", occluded " << render.meshes_occluded.load(std::memory_order_relaxed) << " (" << render.occluder_triangles.load(std::memory_order_relaxed) << " occluder triangles in " << render.occlusion_us.load(std::memory_order_relaxed) << " us)"
+                  << ", " << render.draw_packets.load(std::memory_order_relaxed) << " draws as " << render.draw_commands.load(std::memory_order_relaxed) << " commands in " << render.draw_calls.load(std::memory_order_relaxed) << " calls, " << render.state_changes.load(std::memory_order_relaxed)
+                  << " state changes, " << render.state_changes_saved.load(std::memory_order_relaxed) << " saved"
+                  << ", gl calls " << render.gl_calls.load(std::memory_order_relaxed) << " (" << render.gl_calls_elided.load(std::memory_order_relaxed) << " elided)"
+                  << ", shaded " << render.overdraw_percent.load(std::memory_order_relaxed) << "% of pixels"
+                  << ", render targets " << render.render_target_kb.load(std::memory_order_relaxed) << " KB"
+                  << ", resolution " << render.resolution_percent.load(std::memory_order_relaxed) << "% at " << render.gpu_frame_us.load(std::memory_order_relaxed) << " us gpu)" << std::endl;
     }
 }
 
-REGISTER(start, update)
\ No newline at end of file
+REGISTER(start, update, .name = "fpscounter", .phase = BitForge::Phase::PRE_RENDER, .reads = {}, .writes = {"stdout"}, .after = {})
\ No newline at end of file